@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * allocation_counter.cpp - Heap allocation accounting for the frame path
+ */
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+
+std::atomic<bool> counting{ false };
+std::atomic<uint64_t> allocations{ 0 };
+
+/* Whether the allocations of the calling thread are currently counted. */
+thread_local bool inScope = false;
+
+void *allocate(size_t size)
+{
+	if (inScope && counting.load(std::memory_order_relaxed))
+		allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void *allocateAligned(size_t size, std::align_val_t alignment)
+{
+	if (inScope && counting.load(std::memory_order_relaxed))
+		allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *ptr;
+	if (posix_memalign(&ptr, static_cast<size_t>(alignment), size ? size : 1))
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+} /* namespace */
+
+AllocationScope::AllocationScope(bool count)
+	: previous_(inScope)
+{
+	inScope = count;
+}
+
+AllocationScope::~AllocationScope()
+{
+	inScope = previous_;
+}
+
+void AllocationScope::enable()
+{
+	counting.store(true, std::memory_order_relaxed);
+}
+
+bool AllocationScope::enabled()
+{
+	return counting.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationScope::count()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size)
+{
+	return allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+	return allocate(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	try {
+		return allocate(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	return allocateAligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+	free(ptr);
+}
@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * allocation_counter.h - Heap allocation accounting for the frame path
+ */
+#ifndef __SIMPLE_CAM_ALLOCATION_COUNTER_H__
+#define __SIMPLE_CAM_ALLOCATION_COUNTER_H__
+
+#include <stdint.h>
+
+/*
+ * The global operator new is replaced to count the heap allocations made by
+ * the frame processing path, to check that it never allocates memory.
+ *
+ * Allocations are only counted when counting is enabled, and only while the
+ * allocating thread is inside an AllocationScope that counts them. Scopes can
+ * be nested, to exclude allocations made by code out of our control, such as
+ * libcamera internals.
+ */
+class AllocationScope
+{
+public:
+	AllocationScope(bool count = true);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope &) = delete;
+	AllocationScope &operator=(const AllocationScope &) = delete;
+
+	static void enable();
+	static bool enabled();
+	static uint64_t count();
+
+private:
+	bool previous_;
+};
+
+#endif /* __SIMPLE_CAM_ALLOCATION_COUNTER_H__ */
@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * callable.h - Move-only callable with inline storage
+ */
+#ifndef __SIMPLE_CAM_CALLABLE_H__
+#define __SIMPLE_CAM_CALLABLE_H__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * A Callable wraps a void() function object, in the same way as
+ * std::function<void()>, but never allocates memory. The function object is
+ * stored in a fixed size buffer, and function objects that don't fit are
+ * rejected at compile time. Callables can be moved but not copied, which
+ * also allows wrapping move-only function objects.
+ */
+class Callable
+{
+public:
+	static constexpr size_t kStorageSize = 4 * sizeof(void *);
+
+	Callable()
+		: ops_(nullptr)
+	{
+	}
+
+	template<typename F,
+		 typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Callable>>>
+	Callable(F &&func)
+	{
+		using Func = std::decay_t<F>;
+
+		static_assert(sizeof(Func) <= kStorageSize,
+			      "Function object too large for Callable storage");
+		static_assert(alignof(Func) <= alignof(std::max_align_t),
+			      "Function object alignment not supported");
+		static_assert(std::is_nothrow_move_constructible_v<Func>,
+			      "Function object must be nothrow move constructible");
+
+		new (storage_) Func(std::forward<F>(func));
+		ops_ = &kOps<Func>;
+	}
+
+	Callable(Callable &&other) noexcept
+		: ops_(nullptr)
+	{
+		*this = std::move(other);
+	}
+
+	Callable &operator=(Callable &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		reset();
+
+		if (other.ops_) {
+			other.ops_->move(storage_, other.storage_);
+			ops_ = other.ops_;
+			other.ops_ = nullptr;
+		}
+
+		return *this;
+	}
+
+	Callable(const Callable &) = delete;
+	Callable &operator=(const Callable &) = delete;
+
+	~Callable()
+	{
+		reset();
+	}
+
+	explicit operator bool() const { return ops_ != nullptr; }
+
+	void operator()()
+	{
+		ops_->invoke(storage_);
+	}
+
+	void reset()
+	{
+		if (!ops_)
+			return;
+
+		ops_->destroy(storage_);
+		ops_ = nullptr;
+	}
+
+private:
+	struct Ops {
+		void (*invoke)(void *func);
+		void (*move)(void *dst, void *src);
+		void (*destroy)(void *func);
+	};
+
+	template<typename Func>
+	static constexpr Ops kOps = {
+		[](void *func) { (*static_cast<Func *>(func))(); },
+		[](void *dst, void *src) {
+			Func *from = static_cast<Func *>(src);
+			new (dst) Func(std::move(*from));
+			from->~Func();
+		},
+		[](void *func) { static_cast<Func *>(func)->~Func(); },
+	};
+
+	alignas(std::max_align_t) unsigned char storage_[kStorageSize];
+	const Ops *ops_;
+};
+
+#endif /* __SIMPLE_CAM_CALLABLE_H__ */
@@ -0,0 +1,1162 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * camera_session.cpp - Capture session for a single camera
+ */
+
+#include "camera_session.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iomanip>
+#include <iostream>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocation_counter.h"
+#include "clock.h"
+#include "dmabuf_exporter.h"
+#include "frame_logger.h"
+#ifdef HAVE_EGL
+#include "gpu_sink.h"
+#endif
+#include "numa.h"
+#include "scheduling.h"
+#include "trace.h"
+
+using namespace libcamera;
+
+CameraSession::CameraSession(std::shared_ptr<Camera> camera,
+			     unsigned int index, const Options &options,
+			     EventLoop *loop, FrameLogger *logger,
+			     ThreadPool *pool, Metrics *metrics)
+	: camera_(camera), index_(index), name_("cam" + std::to_string(index)),
+	  acquired_(false), running_(false), pipelined_(options.pipelined),
+	  streams_(options.streams), exportDir_(options.exportDir),
+	  traceDir_(options.traceDir), gpu_(options.gpu),
+	  numBuffers_(options.buffers), numRequests_(options.requests),
+	  lockBuffers_(options.lockBuffers), controls_(camera->controls()), loop_(loop),
+	  rtPriority_(options.rtPriority), cpuTime_(0), logger_(logger),
+	  statsInterval_(options.statsInterval), statsTimer_(0), setupStart_(0),
+	  configured_(0), started_(0), firstFrame_(0), paused_(false),
+	  pausedAt_(0), pausedTime_(0), numa_(options.numa), numaNode_(-1),
+	  remoteBuffers_(0)
+{
+	/*
+	 * Each session handles its own request completions. In threaded mode
+	 * they are dispatched by an event loop dedicated to this camera, so
+	 * that a slow consumer on one camera can't stall the others.
+	 */
+	if (options.threaded) {
+		ownLoop_ = std::make_unique<EventLoop>();
+		loop_ = ownLoop_.get();
+
+		if (index < options.cpus.size())
+			cpus_.push_back(options.cpus[index]);
+	}
+
+	if (numa_ && index < options.numaNodes.size())
+		numaNode_ = options.numaNodes[index];
+
+	if (streams_.empty())
+		streams_.push_back(StreamOptions{});
+
+	/* The consumers run from the event loop of the session. */
+	pipeline_ = std::make_unique<FramePipeline>(name_, options, loop_, logger,
+						    pool, metrics, this);
+
+	if (options.watchdog)
+		watchdog_ = std::make_unique<Watchdog>(loop_, name_, options.watchdog,
+						       [this]() { recover(); });
+
+	/* Decode all the metadata only when it is logged, recorded or traced. */
+	recordControls_ = logger_ || !options.recordDir.empty() || !traceDir_.empty();
+}
+
+CameraSession::~CameraSession()
+{
+	stop();
+
+	camera_->requestCompleted.disconnect(this);
+
+	pipeline_.reset();
+	frames_.clear();
+	mappedBuffers_.clear();
+	requests_.clear();
+	allocator_.reset();
+
+	if (acquired_)
+		camera_->release();
+}
+
+/*
+ * Consumers are handed the frames captured by the session for the given
+ * stream, or for all streams if the stream index is negative, in the order
+ * they are added.
+ */
+void CameraSession::addSink(std::unique_ptr<FrameSink> sink, int stream)
+{
+	pipeline_->addSink(std::move(sink), stream);
+}
+
+int CameraSession::init()
+{
+	setupStart_ = monotonicNs();
+
+	/*
+	 * Application lock usage of Camera by 'acquiring' them.
+	 * Once done with it, application shall similarly 'release' the Camera.
+	 */
+	int ret = camera_->acquire();
+	if (ret) {
+		std::cerr << name_ << ": Can't acquire camera" << std::endl;
+		return ret;
+	}
+
+	acquired_ = true;
+
+	/*
+	 * Stream
+	 *
+	 * Each Camera supports a variable number of Stream. A Stream is
+	 * produced by processing data produced by an image source, usually
+	 * by an ISP.
+	 *
+	 *   +-------------------------------------------------------+
+	 *   | Camera                                                |
+	 *   |                +-----------+                          |
+	 *   | +--------+     |           |------> [  Main output  ] |
+	 *   | | Image  |     |           |                          |
+	 *   | |        |---->|    ISP    |------> [   Viewfinder  ] |
+	 *   | | Source |     |           |                          |
+	 *   | +--------+     |           |------> [ Still Capture ] |
+	 *   |                +-----------+                          |
+	 *   +-------------------------------------------------------+
+	 *
+	 * The number and capabilities of the Stream in a Camera are
+	 * a platform dependent property, and it's the pipeline handler
+	 * implementation that has the responsibility of correctly
+	 * report them.
+	 */
+
+	/*
+	 * --------------------------------------------------------------------
+	 * Camera Configuration.
+	 *
+	 * Camera configuration is tricky! It boils down to assign resources
+	 * of the system (such as DMA engines, scalers, format converters) to
+	 * the different image streams an application has requested.
+	 *
+	 * Depending on the system characteristics, some combinations of
+	 * sizes, formats and stream usages might or might not be possible.
+	 *
+	 * A Camera produces a CameraConfigration based on a set of intended
+	 * roles for each Stream the application requires.
+	 *
+	 * Capturing multiple streams from the same camera, such as a low
+	 * resolution stream for analysis and a high resolution stream for
+	 * recording, lets the ISP produce both images from a single capture,
+	 * instead of scaling images on the CPU.
+	 */
+	std::vector<StreamRole> roles;
+	for (const StreamOptions &stream : streams_)
+		roles.push_back(stream.role);
+
+	config_ = camera_->generateConfiguration(roles);
+	if (!config_ || config_->size() != roles.size()) {
+		std::cerr << name_ << ": Can't generate configuration" << std::endl;
+		return -EINVAL;
+	}
+
+	/*
+	 * The CameraConfiguration contains a StreamConfiguration instance
+	 * for each StreamRole requested by the application, provided
+	 * the Camera can support all of them.
+	 *
+	 * Each StreamConfiguration has default size and format, assigned
+	 * by the Camera depending on the Role the application has requested.
+	 */
+	for (unsigned int i = 0; i < config_->size(); ++i)
+		std::cout << name_ << ": Default stream" << i
+			  << " configuration is: " << config_->at(i).toString()
+			  << std::endl;
+
+	/*
+	 * Each StreamConfiguration parameter which is part of a
+	 * CameraConfiguration can be independently modified by the
+	 * application.
+	 *
+	 * In order to validate the modified parameter, the CameraConfiguration
+	 * should be validated -before- the CameraConfiguration gets applied
+	 * to the Camera.
+	 *
+	 * The CameraConfiguration validation process adjusts each
+	 * StreamConfiguration to a valid value.
+	 *
+	 * The number of buffers trades latency for robustness: fewer buffers
+	 * reduce the time a frame waits to be consumed, more buffers absorb
+	 * consumers bursts without dropping frames.
+	 */
+	for (unsigned int i = 0; i < config_->size(); ++i) {
+		StreamConfiguration &streamConfig = config_->at(i);
+		const StreamOptions &stream = streams_[i];
+
+		if (stream.width && stream.height)
+			streamConfig.size = Size(stream.width, stream.height);
+		if (stream.format.isValid())
+			streamConfig.pixelFormat = stream.format;
+		if (numBuffers_)
+			streamConfig.bufferCount = numBuffers_;
+	}
+
+	/*
+	 * The Camera configuration procedure fails with invalid parameters.
+	 */
+#if 0
+	config_->at(0).size.width = 0; //4096
+	config_->at(0).size.height = 0; //2560
+
+	ret = camera_->configure(config_.get());
+	if (ret) {
+		std::cout << "CONFIGURATION FAILED!" << std::endl;
+		return ret;
+	}
+#endif
+
+	/*
+	 * Validating a CameraConfiguration -before- applying it will adjust it
+	 * to a valid configuration which is as close as possible to the one
+	 * requested.
+	 */
+	if (config_->validate() == CameraConfiguration::Invalid) {
+		std::cerr << name_ << ": Invalid configuration" << std::endl;
+		return -EINVAL;
+	}
+
+	for (unsigned int i = 0; i < config_->size(); ++i)
+		std::cout << name_ << ": Validated stream" << i
+			  << " configuration is: " << config_->at(i).toString()
+			  << std::endl;
+
+	/*
+	 * Once we have a validated configuration, we can apply it to the
+	 * Camera.
+	 */
+	ret = camera_->configure(config_.get());
+	if (ret) {
+		std::cerr << name_ << ": Can't configure camera" << std::endl;
+		return ret;
+	}
+
+	/*
+	 * --------------------------------------------------------------------
+	 * Buffer Allocation
+	 *
+	 * Now that a camera has been configured, it knows all about its
+	 * Streams sizes and formats. The captured images need to be stored in
+	 * framebuffers which can either be provided by the application to the
+	 * library, or allocated in the Camera and exposed to the application
+	 * by libcamera.
+	 *
+	 * An application may decide to allocate framebuffers from elsewhere,
+	 * for example in memory allocated by the display driver that will
+	 * render the captured frames. The application will provide them to
+	 * libcamera by constructing FrameBuffer instances to capture images
+	 * directly into.
+	 *
+	 * Alternatively libcamera can help the application by exporting
+	 * buffers allocated in the Camera using a FrameBufferAllocator
+	 * instance and referencing a configured Camera to determine the
+	 * appropriate buffer size and types to create.
+	 */
+	allocator_ = std::make_unique<FrameBufferAllocator>(camera_);
+	freeBuffers_.resize(config_->size());
+
+	for (unsigned int index = 0; index < config_->size(); ++index) {
+		StreamConfiguration &cfg = config_->at(index);
+
+		ret = allocator_->allocate(cfg.stream());
+		if (ret < 0) {
+			std::cerr << name_ << ": Can't allocate buffers" << std::endl;
+			return ret;
+		}
+
+		size_t allocated = allocator_->buffers(cfg.stream()).size();
+		std::cout << name_ << ": Allocated " << allocated
+			  << " buffers for stream" << std::endl;
+
+		/*
+		 * Applications that need CPU access to the image data have to
+		 * map the buffers. Do it once here, and keep the mappings for
+		 * the lifetime of the buffers.
+		 */
+		for (const std::unique_ptr<FrameBuffer> &buffer : allocator_->buffers(cfg.stream())) {
+			std::unique_ptr<Image> image =
+				Image::fromFrameBuffer(buffer.get(), Image::ReadOnly);
+			if (!image) {
+				std::cerr << name_ << ": Can't map buffer" << std::endl;
+				return -ENOMEM;
+			}
+
+			/*
+			 * Locking the mappings avoids page faults when first
+			 * accessing the data of each buffer, and when the
+			 * system is under memory pressure.
+			 */
+			if (lockBuffers_) {
+				ret = image->lock();
+				if (ret < 0) {
+					std::cerr << name_ << ": Can't lock buffer: "
+						  << strerror(-ret) << std::endl;
+					return ret;
+				}
+			}
+
+			/*
+			 * Each buffer is handed to the consumers through a
+			 * Frame, created once here and reused for every
+			 * capture.
+			 */
+			std::unique_ptr<Frame> frame =
+				std::make_unique<Frame>(pipeline_.get(), index, cfg.stream(),
+							buffer.get(), image.get());
+
+			if (numa_)
+				placeBuffer(image.get(), frame.get());
+
+			frames_[buffer.get()] = std::move(frame);
+			mappedBuffers_[buffer.get()] = std::move(image);
+		}
+
+		freeBuffers_[index].reserve(allocated);
+	}
+
+	if (numa_) {
+		if (numaNode_ < 0) {
+			std::cerr << name_ << ": Can't find the NUMA node of the buffers"
+				  << std::endl;
+		} else {
+			numaCpus_ = numaNodeCpus(numaNode_);
+			std::cout << name_ << ": Using NUMA node " << numaNode_
+				  << ", " << remoteBuffers_
+				  << " buffers on other nodes" << std::endl;
+		}
+	}
+
+	/*
+	 * --------------------------------------------------------------------
+	 * Frame Capture
+	 *
+	 * libcamera frames capture model is based on the 'Request' concept.
+	 * For each frame a Request has to be queued to the Camera.
+	 *
+	 * A Request refers to (at least one) Stream for which a Buffer that
+	 * will be filled with image data shall be added to the Request.
+	 *
+	 * A Request is associated with a list of Controls, which are tunable
+	 * parameters (similar to v4l2_controls) that have to be applied to
+	 * the image.
+	 *
+	 * Once a request completes, all its buffers will contain image data
+	 * that applications can access and for each of them a list of metadata
+	 * properties that reports the capture parameters applied to the image.
+	 *
+	 * Each session owns its own pool of requests.
+	 *
+	 * Each request holds one buffer for each stream, from the buffer pool
+	 * of the stream.
+	 *
+	 * In pipelined mode, the buffers in excess of the number of requests
+	 * (one per stream by default) are kept spare and not associated with
+	 * any request. When a request completes, its buffers are handed to the
+	 * consumers and replaced with spare buffers, so that the request can
+	 * be requeued immediately.
+	 */
+	unsigned int numBuffers = UINT_MAX;
+	for (const StreamConfiguration &cfg : *config_)
+		numBuffers = std::min<unsigned int>(numBuffers,
+						    allocator_->buffers(cfg.stream()).size());
+
+	unsigned int numRequests = numRequests_;
+	if (!numRequests)
+		numRequests = pipelined_ ? numBuffers - 1 : numBuffers;
+
+	if (!numRequests || numRequests > numBuffers ||
+	    (pipelined_ && numRequests == numBuffers)) {
+		std::cerr << name_ << ": Not enough buffers for " << numRequests
+			  << " requests" << std::endl;
+		return -ENOBUFS;
+	}
+
+	for (unsigned int index = 0; index < config_->size(); ++index) {
+		Stream *stream = config_->at(index).stream();
+		const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+			allocator_->buffers(stream);
+
+		if (pipelined_) {
+			for (unsigned int i = numRequests; i < buffers.size(); ++i)
+				freeBuffers_[index].push_back(buffers[i].get());
+		} else if (numRequests < buffers.size()) {
+			std::cout << name_ << ": stream" << index << ": "
+				  << buffers.size() - numRequests
+				  << " buffers left unused without pipelining"
+				  << std::endl;
+		}
+	}
+
+	std::cout << name_ << ": Using " << numRequests << " requests"
+		  << std::endl;
+
+	for (unsigned int i = 0; i < numRequests; ++i) {
+		std::unique_ptr<Request> request = camera_->createRequest(i);
+		if (!request)
+		{
+			std::cerr << name_ << ": Can't create request" << std::endl;
+			return -ENOMEM;
+		}
+
+		for (const StreamConfiguration &cfg : *config_) {
+			Stream *stream = cfg.stream();
+			const std::unique_ptr<FrameBuffer> &buffer =
+				allocator_->buffers(stream)[i];
+
+			ret = request->addBuffer(stream, buffer.get());
+			if (ret < 0)
+			{
+				std::cerr << name_ << ": Can't set buffer for request"
+					  << std::endl;
+				return ret;
+			}
+		}
+
+		requests_.push_back(std::move(request));
+	}
+
+	/*
+	 * Controls can be added to a request on a per frame basis. They are
+	 * queued to the session, and applied to the next request queued to
+	 * the camera.
+	 */
+	controls_.set(controls::Brightness, 0.5);
+
+	pendingFrames_.resize(requests_.size());
+	waitingRequests_.reserve(requests_.size());
+	idleRequests_.reserve(requests_.size());
+
+	ret = createSinks();
+	if (ret < 0)
+		return ret;
+
+	/*
+	 * --------------------------------------------------------------------
+	 * Signal&Slots
+	 *
+	 * libcamera uses a Signal&Slot based system to connect events to
+	 * callback operations meant to handle them, inspired by the QT graphic
+	 * toolkit.
+	 *
+	 * Signals are events 'emitted' by a class instance.
+	 * Slots are callbacks that can be 'connected' to a Signal.
+	 *
+	 * A Camera exposes Signals, to report the completion of a Request and
+	 * the completion of a Buffer part of a Request to support partial
+	 * Request completions.
+	 *
+	 * In order to receive the notification for request completions,
+	 * applications shall connecte a Slot to the Camera 'requestCompleted'
+	 * Signal before the camera is started.
+	 */
+	camera_->requestCompleted.connect(this, &CameraSession::requestComplete);
+
+	configured_ = monotonicNs();
+
+	return 0;
+}
+
+/*
+ * Place the memory of a buffer on the NUMA node of the session. Without an
+ * explicit node, the session follows the node of the first buffer, which the
+ * driver normally allocates close to the device.
+ *
+ * Device memory can't always be migrated, the node the buffer ends up on is
+ * checked afterwards, and recorded in the frame.
+ */
+void CameraSession::placeBuffer(Image *image, Frame *frame)
+{
+	if (numaNode_ < 0) {
+		int node = image->node();
+		if (node < 0)
+			return;
+
+		numaNode_ = node;
+	}
+
+	image->bind(numaNode_);
+
+	int node = image->node();
+	if (node < 0)
+		return;
+
+	frame->setMemoryNode(node);
+	if (node != numaNode_)
+		remoteBuffers_++;
+}
+
+/*
+ * Consumers are set up once the camera is configured, from the validated
+ * format, size and stride of the stream they apply to. The consumers that
+ * require the buffers allocated by the camera are added to the ones created
+ * by the pipeline.
+ */
+int CameraSession::createSinks()
+{
+	std::vector<FramePipeline::StreamConfig> streams;
+	for (const StreamConfiguration &cfg : *config_)
+		streams.push_back({ cfg, &allocator_->buffers(cfg.stream()) });
+
+	pipeline_->setNumaNode(numaNode_);
+
+	int ret = pipeline_->configure(streams);
+	if (ret < 0)
+		return ret;
+
+	/* Traces hold all the frames of all the streams, for replay. */
+	if (!traceDir_.empty())
+		addSink(std::make_unique<TraceWriter>(traceDir_ + "/" + name_ + ".trace",
+						      *config_, *allocator_, frames_.size()));
+
+	if (!exportDir_.empty())
+		addSink(std::make_unique<DmabufExporter>(loop_, exportDir_ + "/" + name_ + ".sock",
+							 *config_, *allocator_));
+
+	if (gpu_) {
+#ifdef HAVE_EGL
+		addSink(std::make_unique<GpuSink>(loop_, *config_, *allocator_));
+#else
+		std::cerr << name_ << ": GPU import requires EGL support" << std::endl;
+		return -ENOTSUP;
+#endif
+	}
+
+	return 0;
+}
+
+int CameraSession::start()
+{
+	/*
+	 * The thread dispatching the request completions has to be running
+	 * before the first request completes.
+	 */
+	if (ownLoop_)
+		thread_ = std::thread(&CameraSession::run, this);
+
+	/*
+	 * --------------------------------------------------------------------
+	 * Start Capture
+	 *
+	 * In order to capture frames the Camera has to be started and
+	 * Request queued to it. Enough Request to fill the Camera pipeline
+	 * depth have to be queued before the Camera start delivering frames.
+	 *
+	 * For each delivered frame, the Slot connected to the
+	 * Camera::requestCompleted Signal is called.
+	 */
+	int ret = camera_->start();
+	if (ret) {
+		std::cerr << name_ << ": Failed to start camera" << std::endl;
+		stop();
+		return ret;
+	}
+
+	running_ = true;
+
+	/* Statistics are reported periodically from the session thread. */
+	if (statsInterval_)
+		statsTimer_ = loop_->addPeriodicTimer(std::chrono::seconds(statsInterval_),
+						      [this]() { reportStats(); });
+
+	ret = pipeline_->start(requests_.size());
+	if (ret < 0) {
+		stop();
+		return ret;
+	}
+
+	firstFrame_ = 0;
+	pausedTime_ = 0;
+
+	for (std::unique_ptr<Request> &request : requests_)
+		queueRequest(request.get());
+
+	started_ = monotonicNs();
+
+	/* The watchdog runs in the session thread, as the frame processing. */
+	if (watchdog_)
+		loop_->callLater([this]() { watchdog_->start(); });
+
+	return 0;
+}
+
+void CameraSession::stop()
+{
+	bool running = running_;
+
+	if (running_) {
+		if (watchdog_)
+			watchdog_->stop();
+
+		if (statsTimer_) {
+			loop_->cancelTimer(statsTimer_);
+			statsTimer_ = 0;
+		}
+
+		/* Requests cancelled now are not kept for a resume. */
+		if (paused_.exchange(false)) {
+			pausedTime_ += monotonicNs() - pausedAt_;
+			idleRequests_.clear();
+		}
+
+		camera_->stop();
+	}
+
+	/*
+	 * Consumers may be driven by the session event loop, stop them once
+	 * the loop has stopped.
+	 */
+	if (thread_.joinable()) {
+		ownLoop_->exit();
+		thread_.join();
+	}
+
+	if (running_) {
+		pipeline_->stop();
+		running_ = false;
+	}
+
+	/* The statistics are only safe to access once the thread has stopped. */
+	if (running)
+		reportStats();
+}
+
+/*
+ * Pause and resume the capture, from any thread. The camera is stopped, but
+ * buffers, requests and mappings are kept, and the consumers keep running, so
+ * that the capture can resume without having to set the camera up again.
+ */
+void CameraSession::pause()
+{
+	loop_->callLater([this]() { pauseCapture(); });
+}
+
+void CameraSession::resume()
+{
+	loop_->callLater([this]() { resumeCapture(); });
+}
+
+int CameraSession::pauseCapture()
+{
+	if (!running_ || paused_.load(std::memory_order_relaxed))
+		return 0;
+
+	/*
+	 * Stopping the camera cancels the queued requests, which are then
+	 * collected as idle requests. Requests completed earlier are still
+	 * processed normally, and join the idle requests when requeued.
+	 */
+	paused_.store(true, std::memory_order_release);
+
+	if (watchdog_)
+		watchdog_->stop();
+
+	int ret = camera_->stop();
+	if (ret) {
+		std::cerr << name_ << ": Failed to pause camera" << std::endl;
+
+		/* The capture goes on, and is watched again. */
+		paused_.store(false, std::memory_order_release);
+		if (watchdog_)
+			watchdog_->start();
+
+		return ret;
+	}
+
+	pausedAt_ = monotonicNs();
+
+	std::cout << name_ << ": Capture paused" << std::endl;
+
+	return 0;
+}
+
+int CameraSession::resumeCapture()
+{
+	if (!running_ || !paused_.load(std::memory_order_relaxed))
+		return 0;
+
+	int ret = camera_->start();
+	if (ret) {
+		std::cerr << name_ << ": Failed to resume camera" << std::endl;
+		return ret;
+	}
+
+	paused_.store(false, std::memory_order_release);
+
+	/* The time spent paused isn't accounted for in the statistics. */
+	pipeline_->restartStats();
+
+	pausedTime_ += monotonicNs() - pausedAt_;
+
+	/*
+	 * Requests still waiting for their frames to be released, or for
+	 * spare buffers, are queued when they become available.
+	 */
+	for (Request *request : idleRequests_)
+		queueRequest(request);
+	idleRequests_.clear();
+
+	if (watchdog_)
+		watchdog_->start();
+
+	std::cout << name_ << ": Capture resumed" << std::endl;
+
+	return 0;
+}
+
+/*
+ * Restart a stalled camera, keeping its buffers and requests, called by the
+ * watchdog from the session thread. When the camera fails to stop, the
+ * capture goes on. When it fails to start again, the capture stays paused. In
+ * both cases, the watchdog retries after the next timeout.
+ */
+void CameraSession::recover()
+{
+	uint64_t start = monotonicNs();
+
+	/* The watchdog is restarted by pauseCapture() when it fails. */
+	if (pauseCapture() < 0) {
+		std::cerr << name_ << ": Failed to restart camera, retrying"
+			  << std::endl;
+		return;
+	}
+
+	if (resumeCapture() < 0) {
+		std::cerr << name_ << ": Failed to restart camera, retrying"
+			  << std::endl;
+		watchdog_->start();
+		return;
+	}
+
+	std::cout << name_ << ": Camera restarted in " << std::fixed
+		  << std::setprecision(1) << (monotonicNs() - start) / 1000000.0
+		  << " ms" << std::defaultfloat << std::endl;
+}
+
+void CameraSession::run()
+{
+	/* Explicit CPUs take precedence over the CPUs of the NUMA node. */
+	const std::vector<unsigned int> &cpus = cpus_.empty() ? numaCpus_ : cpus_;
+	if (!cpus.empty()) {
+		int ret = setThreadAffinity(cpus);
+		if (ret < 0)
+			std::cerr << name_ << ": Failed to set CPU affinity: "
+				  << strerror(-ret) << std::endl;
+	}
+
+	if (rtPriority_) {
+		int ret = setThreadRealtime(rtPriority_);
+		if (ret < 0)
+			std::cerr << name_ << ": Failed to set real-time priority: "
+				  << strerror(-ret) << std::endl;
+	}
+
+	scheduling_ = threadScheduling();
+
+	struct timespec start;
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+	loop_->exec();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+
+	cpuTime_ = (end.tv_sec - start.tv_sec) * 1000000000ULL
+		 + end.tv_nsec - start.tv_nsec;
+}
+
+/*
+ * --------------------------------------------------------------------
+ * Handle RequestComplete
+ *
+ * For each Camera::requestCompleted Signal emitted from the Camera the
+ * connected Slot is invoked.
+ *
+ * The Slot is invoked in the CameraManager's thread, hence one should avoid
+ * any heavy processing here. The processing of the request shall be re-directed
+ * to the application's thread instead, so as not to block the CameraManager's
+ * thread for large amount of time.
+ *
+ * The Slot receives the Request as a parameter.
+ */
+void CameraSession::requestComplete(Request *request)
+{
+	/*
+	 * Requests cancelled when pausing the capture are kept with their
+	 * buffers, to be queued again on resume.
+	 */
+	if (request->status() == Request::RequestCancelled) {
+		if (paused_.load(std::memory_order_acquire))
+			loop_->callLater([this, request]() {
+				request->reuse(Request::ReuseBuffers);
+				queueRequest(request);
+			});
+		return;
+	}
+
+	/*
+	 * Record the completion time here, to measure separately the time
+	 * spent by the request in the event loop queue.
+	 */
+	uint64_t completed = monotonicNs();
+
+	pipeline_->queue();
+	loop_->callLater([this, request, completed]() {
+		processRequest(request, completed);
+	});
+}
+
+unsigned int CameraSession::streamIndex(const Stream *stream) const
+{
+	for (unsigned int i = 0; i < config_->size(); ++i) {
+		if (config_->at(i).stream() == stream)
+			return i;
+	}
+
+	return 0;
+}
+
+void CameraSession::reportStats() const
+{
+	for (unsigned int i = 0; i < config_->size(); ++i) {
+		std::string prefix = name_ + ": stream" + std::to_string(i) + ": ";
+
+		std::cout << prefix
+			  << allocator_->buffers(config_->at(i).stream()).size()
+			  << " buffers, " << requests_.size() << " requests"
+			  << std::endl;
+
+		pipeline_->stats(i).report(std::cout, prefix);
+	}
+
+	if (pipeline_->dropped())
+		std::cout << name_ << ": " << pipeline_->dropped()
+			  << " requests dropped by policy" << std::endl;
+
+	if (numa_)
+		reportNuma();
+}
+
+/*
+ * Report how many frames were processed away from the NUMA node of their
+ * buffer, and how many buffers ended up on another node than the camera.
+ */
+void CameraSession::reportNuma() const
+{
+	if (numaNode_ < 0)
+		return;
+
+	uint64_t local = pipeline_->localFrames();
+	uint64_t remote = pipeline_->remoteFrames();
+
+	std::cout << name_ << ": NUMA node " << numaNode_ << ": " << remote
+		  << " cross-node frames out of " << local + remote << ", "
+		  << remoteBuffers_ << " buffers on other nodes" << std::endl;
+}
+
+/*
+ * Report how long the camera took to deliver its first frame, from the start
+ * of its configuration, along with the configuration and start-up times.
+ */
+void CameraSession::reportStartup() const
+{
+	std::cout << name_ << ": configured in " << std::fixed
+		  << std::setprecision(1)
+		  << (configured_ - setupStart_) / 1000000.0 << " ms, started in "
+		  << (started_ - configured_) / 1000000.0 << " ms, ";
+
+	if (firstFrame_)
+		std::cout << "first frame after "
+			  << (firstFrame_ - setupStart_) / 1000000.0 << " ms";
+	else
+		std::cout << "no frame captured";
+
+	std::cout << std::defaultfloat << std::endl;
+}
+
+/*
+ * Print the benchmark summary of the session, for a capture that lasted for
+ * the given duration in nanoseconds. The CPU usage is only known when the
+ * session runs its own thread, and is otherwise reported by the application
+ * for its event loop.
+ */
+void CameraSession::reportSummary(uint64_t duration) const
+{
+	for (unsigned int i = 0; i < config_->size(); ++i) {
+		const FrameStats &stats = pipeline_->stats(i);
+		const StreamConfiguration &cfg = config_->at(i);
+
+		std::cout << name_ << ": stream" << i << ": "
+			  << cfg.toString() << ": " << stats.frames()
+			  << " frames, " << stats.dropped() << " dropped, "
+			  << std::fixed << std::setprecision(2)
+			  << stats.frameRate() << " fps, "
+			  << stats.byteRate() / 1000000.0 << " MB/s"
+			  << std::defaultfloat << std::endl;
+
+		/*
+		 * The tail latencies show the effect of the scheduling of the
+		 * event loop threads.
+		 */
+		const Histogram &capture = stats.captureLatency();
+		const Histogram &dispatch = stats.dispatchLatency();
+		if (!dispatch.count())
+			continue;
+
+		std::cout << name_ << ": stream" << i << ": latency p99 "
+			  << std::fixed << std::setprecision(3)
+			  << capture.percentile(99) / 1000000.0 << " + "
+			  << dispatch.percentile(99) / 1000000.0 << " ms, p99.9 "
+			  << capture.percentile(99.9) / 1000000.0 << " + "
+			  << dispatch.percentile(99.9) / 1000000.0
+			  << " ms (capture + dispatch)" << std::defaultfloat
+			  << std::endl;
+	}
+
+	std::cout << name_ << ": " << pipeline_->dropped()
+		  << " requests dropped by policy" << std::endl;
+
+	if (pausedTime_)
+		std::cout << name_ << ": paused for " << pausedTime_ / 1000000
+			  << " ms" << std::endl;
+
+	if (watchdog_)
+		watchdog_->report(std::cout, name_ + ": ");
+
+	if (numa_)
+		reportNuma();
+
+	if (ownLoop_)
+		std::cout << name_ << ": thread CPU usage " << std::fixed
+			  << std::setprecision(1) << cpuTime_ * 100.0 / duration
+			  << "%" << std::defaultfloat << " (" << scheduling_ << ")"
+			  << std::endl;
+}
+
+void CameraSession::processRequest(Request *request, uint64_t completed)
+{
+	uint64_t now = monotonicNs();
+
+	if (!firstFrame_)
+		firstFrame_ = completed;
+
+	/*
+	 * Processing a request must not allocate memory. When checked, heap
+	 * allocations are counted after the warmup, once the consumers have
+	 * settled.
+	 */
+	AllocationScope allocations(pipeline_->countAllocations());
+
+	/*
+	 * Decide whether the consumers can take the request, from the number
+	 * of newer requests that have completed already, and the number of
+	 * frames the consumers still hold.
+	 */
+	bool admitted = pipeline_->admit();
+
+	/*
+	 * When a request has completed, it is populated with a metadata control
+	 * list that allows an application to determine various properties of
+	 * the completed request. This can include the timestamp of the Sensor
+	 * capture, or its gain and exposure values, or properties from the IPA
+	 * such as the state of the 3A algorithms.
+	 *
+	 * Printing the metadata from this thread would delay re-queuing the
+	 * request to the camera, and cause frame drops at high frame rates.
+	 *
+	 * The few controls consumers need are extracted by a filter to typed
+	 * values stored in the frames. When the metadata is logged or
+	 * recorded, all scalar numerical controls are additionally copied to
+	 * a compact binary record, handed to the FrameLogger which formats or
+	 * stores them from a background thread. The record is also stored in
+	 * the frame, for the consumers.
+	 */
+	FrameRecord record = {};
+	record.camera = index_;
+
+	CaptureMetadata captured;
+	const CaptureMetadataFilter &metadataFilter = pipeline_->metadataFilter();
+
+	const ControlList &requestMetadata = request->metadata();
+	for (const auto &[id, value] : requestMetadata) {
+		metadataFilter.match(id, value, &captured);
+
+		if (!recordControls_ ||
+		    record.numControls == FrameRecord::kMaxControls)
+			continue;
+
+		if (value.isArray())
+			continue;
+
+		FrameRecord::Control &ctrl = record.controls[record.numControls];
+		ctrl.id = id;
+		ctrl.type = FrameRecord::Integer;
+
+		switch (value.type()) {
+		case ControlTypeBool:
+			ctrl.integer = value.get<bool>();
+			break;
+		case ControlTypeByte:
+			ctrl.integer = value.get<uint8_t>();
+			break;
+		case ControlTypeInteger32:
+			ctrl.integer = value.get<int32_t>();
+			break;
+		case ControlTypeInteger64:
+			ctrl.integer = value.get<int64_t>();
+			break;
+		case ControlTypeFloat:
+			ctrl.type = FrameRecord::Float;
+			ctrl.real = value.get<float>();
+			break;
+		default:
+			continue;
+		}
+
+		record.numControls++;
+	}
+
+	/*
+	 * Each buffer has its own FrameMetadata to describe its state, or the
+	 * usage of each buffer. While in our simple capture we only provide one
+	 * buffer per request, a request can have a buffer for each stream that
+	 * is established when configuring the camera.
+	 *
+	 * This allows a viewfinder and a still image to be processed at the
+	 * same time, or to allow obtaining the RAW capture buffer from the
+	 * sensor along with the image as processed by the ISP.
+	 */
+	const Request::BufferMap &buffers = request->buffers();
+	for (const auto &[stream, buffer] : buffers) {
+		const FrameMetadata &metadata = buffer->metadata();
+
+		record.stream = streamIndex(stream);
+		record.sequence = metadata.sequence;
+		record.timestamp = metadata.timestamp;
+		record.numPlanes = 0;
+
+		for (const FrameMetadata::Plane &plane : metadata.planes()) {
+			if (record.numPlanes == FrameRecord::kMaxPlanes)
+				break;
+			record.bytesused[record.numPlanes++] = plane.bytesused;
+		}
+
+		Frame *frame = frames_.at(buffer).get();
+		frame->record() = record;
+		frame->setCompleted(completed);
+		frame->captureMetadata() = captured;
+		frame->setRequest(pipelined_ ? nullptr : request);
+		pipeline_->addFrame(frame, now);
+	}
+
+	if (watchdog_) {
+		std::optional<int64_t> duration =
+			captured.get<controls::FrameDuration>();
+		watchdog_->frameCompleted(completed, record.sequence,
+					  duration ? *duration * 1000 : 0);
+	}
+
+	/*
+	 * In pipelined mode, the captured buffers now belong to the consumers.
+	 * Requeue the request right away with spare buffers, if available, to
+	 * keep the camera pipeline full while the frames are consumed.
+	 */
+	if (pipelined_) {
+		request->reuse();
+		waitingRequests_.push_back(request);
+		queueWaitingRequests();
+	} else {
+		pendingFrames_[request->cookie()] = buffers.size();
+	}
+
+	pipeline_->dispatch(admitted);
+}
+
+/*
+ * Called by the pipeline, in the session thread, once the consumers have
+ * released a frame.
+ */
+void CameraSession::recycleFrame(Frame *frame)
+{
+	Request *request = frame->request();
+
+	/* Re-queue the Request to the camera once all its frames are free. */
+	if (request) {
+		frame->setRequest(nullptr);
+
+		if (--pendingFrames_[request->cookie()])
+			return;
+
+		request->reuse(Request::ReuseBuffers);
+		queueRequest(request);
+		return;
+	}
+
+	freeBuffers_[frame->streamIndex()].push_back(frame->buffer());
+	queueWaitingRequests();
+}
+
+/*
+ * Requeue the requests waiting for buffers, as long as a free buffer is
+ * available for every stream.
+ */
+void CameraSession::queueWaitingRequests()
+{
+	while (!waitingRequests_.empty()) {
+		for (const std::vector<FrameBuffer *> &buffers : freeBuffers_) {
+			if (buffers.empty())
+				return;
+		}
+
+		Request *request = waitingRequests_.front();
+		waitingRequests_.erase(waitingRequests_.begin());
+
+		for (unsigned int i = 0; i < freeBuffers_.size(); ++i) {
+			FrameBuffer *buffer = freeBuffers_[i].back();
+			freeBuffers_[i].pop_back();
+
+			/* This allocates a node of the request buffer map. */
+			AllocationScope uncounted(false);
+			request->addBuffer(config_->at(i).stream(), buffer);
+		}
+
+		queueRequest(request);
+	}
+}
+
+/*
+ * Apply the pending control updates to the request, and queue it to the
+ * camera. Both allocate memory inside libcamera, to store the controls in the
+ * request and to dispatch it to the pipeline handler thread, which is out of
+ * the control of the application.
+ */
+void CameraSession::queueRequest(Request *request)
+{
+	/* While paused, requests are kept until the capture resumes. */
+	if (paused_.load(std::memory_order_relaxed)) {
+		idleRequests_.push_back(request);
+		return;
+	}
+
+	AllocationScope uncounted(false);
+
+	controls_.apply(&request->controls());
+	camera_->queueRequest(request);
+}
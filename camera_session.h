@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * camera_session.h - Capture session for a single camera
+ */
+#ifndef __SIMPLE_CAM_CAMERA_SESSION_H__
+#define __SIMPLE_CAM_CAMERA_SESSION_H__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libcamera/libcamera.h>
+
+#include "control_queue.h"
+#include "event_loop.h"
+#include "frame_pipeline.h"
+#include "frame_sink.h"
+#include "image.h"
+#include "metrics.h"
+#include "watchdog.h"
+
+#include "options.h"
+
+class FrameLogger;
+class ThreadPool;
+
+class CameraSession : public FramePipeline::Source
+{
+public:
+	CameraSession(std::shared_ptr<libcamera::Camera> camera,
+		      unsigned int index, const Options &options,
+		      EventLoop *loop, FrameLogger *logger,
+		      ThreadPool *pool = nullptr, Metrics *metrics = nullptr);
+	~CameraSession();
+
+	const std::string &name() const { return name_; }
+	libcamera::Camera *camera() const { return camera_.get(); }
+
+	void addSink(std::unique_ptr<FrameSink> sink, int stream = -1);
+
+	/* Control updates, applied to the next request queued to the camera. */
+	ControlQueue &controls() { return controls_; }
+
+	int init();
+	int start();
+	void stop();
+
+	void pause();
+	void resume();
+
+	void reportStartup() const;
+	void reportSummary(uint64_t duration) const;
+
+	/* NUMA node the session is placed on, or -1. */
+	int numaNode() const { return numaNode_; }
+
+	/* True if a consumer failed during the capture, once stopped. */
+	bool failed() const { return pipeline_->failed(); }
+
+	/* Number of requests processed while counting heap allocations. */
+	uint64_t countedRequests() const { return pipeline_->countedRequests(); }
+
+private:
+	void requestComplete(libcamera::Request *request);
+	void processRequest(libcamera::Request *request, uint64_t completed);
+
+	void recycleFrame(Frame *frame) override;
+	void queueWaitingRequests();
+	void queueRequest(libcamera::Request *request);
+
+	int createSinks();
+	void placeBuffer(Image *image, Frame *frame);
+
+	int pauseCapture();
+	int resumeCapture();
+	void recover();
+
+	void run();
+
+	unsigned int streamIndex(const libcamera::Stream *stream) const;
+	void reportStats() const;
+	void reportNuma() const;
+
+	std::shared_ptr<libcamera::Camera> camera_;
+	unsigned int index_;
+	std::string name_;
+	bool acquired_;
+	bool running_;
+	bool pipelined_;
+	std::vector<StreamOptions> streams_;
+	std::string exportDir_;
+	std::string traceDir_;
+	bool gpu_;
+	unsigned int numBuffers_;
+	unsigned int numRequests_;
+	bool lockBuffers_;
+
+	ControlQueue controls_;
+
+	std::unique_ptr<libcamera::CameraConfiguration> config_;
+	std::unique_ptr<libcamera::FrameBufferAllocator> allocator_;
+	std::map<const libcamera::FrameBuffer *, std::unique_ptr<Image>> mappedBuffers_;
+	std::vector<std::unique_ptr<libcamera::Request>> requests_;
+
+	std::map<const libcamera::FrameBuffer *, std::unique_ptr<Frame>> frames_;
+
+	/* Number of frames still held by consumers, per request cookie. */
+	std::vector<unsigned int> pendingFrames_;
+
+	/*
+	 * In pipelined mode, buffers released by consumers are kept per stream
+	 * until a completed request can be requeued with them.
+	 */
+	std::vector<std::vector<libcamera::FrameBuffer *>> freeBuffers_;
+	std::vector<libcamera::Request *> waitingRequests_;
+
+	/*
+	 * When running threaded, the session owns its event loop and the thread
+	 * running it. Otherwise it shares the event loop of the application.
+	 */
+	std::unique_ptr<EventLoop> ownLoop_;
+	EventLoop *loop_;
+	std::thread thread_;
+	std::vector<unsigned int> cpus_;
+	unsigned int rtPriority_;
+	std::string scheduling_;
+	uint64_t cpuTime_;
+
+	FrameLogger *logger_;
+	bool recordControls_;
+
+	/*
+	 * The consumers, with the drop policy, reordering, statistics and
+	 * metrics of the frames handed to them.
+	 */
+	std::unique_ptr<FramePipeline> pipeline_;
+	unsigned int statsInterval_;
+	EventLoop::TimerId statsTimer_;
+
+	/* Start-up timestamps, to measure the time to the first frame. */
+	uint64_t setupStart_;
+	uint64_t configured_;
+	uint64_t started_;
+	uint64_t firstFrame_;
+
+	/*
+	 * While paused, the requests that would be queued to the camera are
+	 * kept idle instead, and queued when the capture resumes.
+	 */
+	std::atomic<bool> paused_;
+	std::vector<libcamera::Request *> idleRequests_;
+	uint64_t pausedAt_;
+	uint64_t pausedTime_;
+
+	/*
+	 * NUMA placement, if enabled, with the number of buffers that ended up
+	 * on another node than the one of the session.
+	 */
+	bool numa_;
+	int numaNode_;
+	std::vector<unsigned int> numaCpus_;
+	unsigned int remoteBuffers_;
+
+	/* Restarts the camera when it stops delivering frames, if enabled. */
+	std::unique_ptr<Watchdog> watchdog_;
+};
+
+#endif /* __SIMPLE_CAM_CAMERA_SESSION_H__ */
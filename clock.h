@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * clock.h - Time measurement helpers
+ */
+#ifndef __SIMPLE_CAM_CLOCK_H__
+#define __SIMPLE_CAM_CLOCK_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Return the current CLOCK_MONOTONIC time in nanoseconds. This is the clock
+ * used for the FrameMetadata timestamps.
+ */
+static inline uint64_t monotonicNs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif /* __SIMPLE_CAM_CLOCK_H__ */
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * control_queue.cpp - Per-frame control updates
+ */
+
+#include "control_queue.h"
+
+#include <errno.h>
+
+using namespace libcamera;
+
+ControlQueue::ControlQueue(const ControlInfoMap &info)
+	: info_(info), hasPending_(false), numPending_(0), numCurrent_(0)
+{
+}
+
+/*
+ * Queue a control update for the next request. This can be called from any
+ * thread. Return -ENOENT if the camera doesn't support the control, and
+ * -ENOSPC if too many different controls are already waiting.
+ */
+int ControlQueue::set(const ControlId &id, const ControlValue &value)
+{
+	if (info_.find(&id) == info_.end())
+		return -ENOENT;
+
+	std::unique_lock<std::mutex> locker(lock_);
+
+	bool unchanged = false;
+	for (unsigned int i = 0; i < numCurrent_; ++i) {
+		if (current_[i].id == &id) {
+			unchanged = current_[i].value == value;
+			break;
+		}
+	}
+
+	for (unsigned int i = 0; i < numPending_; ++i) {
+		if (pending_[i].id != &id)
+			continue;
+
+		if (unchanged)
+			pending_[i] = pending_[--numPending_];
+		else
+			pending_[i].value = value;
+
+		hasPending_.store(numPending_ != 0, std::memory_order_release);
+		return 0;
+	}
+
+	if (unchanged)
+		return 0;
+
+	if (numPending_ == kMaxControls)
+		return -ENOSPC;
+
+	pending_[numPending_++] = { &id, value };
+	hasPending_.store(true, std::memory_order_release);
+
+	return 0;
+}
+
+/*
+ * Add the pending updates to the controls of a request about to be queued,
+ * and return their number. This is called from the session thread.
+ */
+unsigned int ControlQueue::apply(ControlList *controls)
+{
+	if (!hasPending_.load(std::memory_order_acquire))
+		return 0;
+
+	std::unique_lock<std::mutex> locker(lock_);
+
+	unsigned int count = numPending_;
+
+	for (unsigned int i = 0; i < numPending_; ++i) {
+		const Entry &entry = pending_[i];
+
+		controls->set(entry.id->id(), entry.value);
+
+		/*
+		 * Remember the applied value to skip later updates that don't
+		 * change it. Controls that don't fit are always applied.
+		 */
+		unsigned int j;
+		for (j = 0; j < numCurrent_; ++j) {
+			if (current_[j].id == entry.id)
+				break;
+		}
+
+		if (j < numCurrent_)
+			current_[j].value = entry.value;
+		else if (numCurrent_ < kMaxControls)
+			current_[numCurrent_++] = entry;
+	}
+
+	numPending_ = 0;
+	hasPending_.store(false, std::memory_order_relaxed);
+
+	return count;
+}
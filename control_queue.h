@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * control_queue.h - Per-frame control updates
+ */
+#ifndef __SIMPLE_CAM_CONTROL_QUEUE_H__
+#define __SIMPLE_CAM_CONTROL_QUEUE_H__
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+#include <libcamera/controls.h>
+
+/*
+ * The ControlQueue collects the control changes requested by the application,
+ * for instance by its exposure and gain algorithms, from any thread, and
+ * applies them to the next request queued to the camera.
+ *
+ * Controls keep their value until changed, so only the difference with the
+ * values applied last is added to the request. Multiple updates of the same
+ * control between two requests are coalesced, and setting a control back to
+ * the value it already has cancels the update.
+ *
+ * Updates are stored in fixed-size arrays, and queueing scalar controls
+ * doesn't allocate memory.
+ */
+class ControlQueue
+{
+public:
+	static constexpr unsigned int kMaxControls = 16;
+
+	ControlQueue(const libcamera::ControlInfoMap &info);
+
+	template<typename T>
+	int set(const libcamera::Control<T> &ctrl, const std::common_type_t<T> &value)
+	{
+		return set(ctrl, libcamera::ControlValue(value));
+	}
+
+	int set(const libcamera::ControlId &id, const libcamera::ControlValue &value);
+
+	unsigned int apply(libcamera::ControlList *controls);
+
+private:
+	struct Entry {
+		const libcamera::ControlId *id;
+		libcamera::ControlValue value;
+	};
+
+	const libcamera::ControlInfoMap &info_;
+
+	std::mutex lock_;
+	std::atomic<bool> hasPending_;
+
+	/* Updates not applied yet, and last applied values, protected by lock_. */
+	std::array<Entry, kMaxControls> pending_;
+	unsigned int numPending_;
+	std::array<Entry, kMaxControls> current_;
+	unsigned int numCurrent_;
+};
+
+#endif /* __SIMPLE_CAM_CONTROL_QUEUE_H__ */
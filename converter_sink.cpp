@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * converter_sink.cpp - Frame sink converting frames to another pixel format
+ */
+
+#include "converter_sink.h"
+
+#include <vector>
+
+#include "allocation_counter.h"
+
+using namespace libcamera;
+
+ConverterSink::ConverterSink(std::unique_ptr<FormatConverter> converter)
+	: converter_(std::move(converter)), bytes_(0)
+{
+}
+
+void ConverterSink::processFrame(Frame *frame)
+{
+	if (frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	/* The buffer is shared by all the converters running in the thread. */
+	static thread_local std::vector<uint8_t> buffer;
+
+	size_t size = converter_->outputSize();
+	if (buffer.size() < size) {
+		/* Once per thread, the first time a frame is converted. */
+		AllocationScope uncounted(false);
+		buffer.resize(size);
+	}
+
+	Span<uint8_t> output{ buffer.data(), size };
+	converter_->convert(frame->image(), output);
+	bytes_.fetch_add(size, std::memory_order_relaxed);
+
+	processImage(frame, output);
+}
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * converter_sink.h - Frame sink converting frames to another pixel format
+ */
+#ifndef __SIMPLE_CAM_CONVERTER_SINK_H__
+#define __SIMPLE_CAM_CONVERTER_SINK_H__
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+#include <libcamera/base/span.h>
+
+#include "format_converter.h"
+#include "frame_sink.h"
+
+/*
+ * The ConverterSink converts every frame it receives to the output format of
+ * its converter. Frames are converted concurrently when a thread pool is
+ * used, each thread converting to its own buffer, allocated on first use and
+ * reused afterwards. Subclasses consume the converted images by overriding
+ * processImage(), which must thus be thread-safe.
+ */
+class ConverterSink : public FrameSink
+{
+public:
+	ConverterSink(std::unique_ptr<FormatConverter> converter);
+
+	const FormatConverter &converter() const { return *converter_; }
+	uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+	void processFrame(Frame *frame) override;
+	bool concurrent() const override { return true; }
+
+protected:
+	/* Called with the converted image, which is valid until it returns. */
+	virtual void processImage([[maybe_unused]] const Frame *frame,
+				  [[maybe_unused]] libcamera::Span<const uint8_t> image)
+	{
+	}
+
+private:
+	std::unique_ptr<FormatConverter> converter_;
+	std::atomic<uint64_t> bytes_;
+};
+
+#endif /* __SIMPLE_CAM_CONVERTER_SINK_H__ */
@@ -0,0 +1,258 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * disk_writer.cpp - Frame sink streaming frames to disk
+ */
+
+#include "disk_writer.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace libcamera;
+
+namespace {
+
+constexpr char kMagic[4] = { 'S', 'C', 'F', 'R' };
+
+/*
+ * Direct I/O requires the buffer address, file offset and transfer size to
+ * be aligned to the logical block size of the device. 4 KiB is a multiple of
+ * the block size of all common storage devices.
+ */
+constexpr size_t kAlignment = 4096;
+
+size_t alignUp(size_t value)
+{
+	return (value + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+} /* namespace */
+
+/*
+ * Frames are written with O_DIRECT, bypassing the page cache, so that
+ * sustained capture to disk doesn't evict everything else from memory and
+ * stall on page cache writeback. The dmabuf mappings of the buffers can't be
+ * used for direct I/O, so each frame is copied to an aligned bounce buffer
+ * before being written. File systems that don't support direct I/O fall back
+ * to buffered writes.
+ */
+DiskWriter::DiskWriter(const std::string &filename, size_t frameSize,
+		       size_t queueSize)
+	: filename_(filename), frameSize_(frameSize), queue_(queueSize),
+	  pending_(0), running_(false), fd_(-1), direct_(false),
+	  buffer_(nullptr), bufferSize_(0), frames_(0), bytes_(0),
+	  dropped_(0), truncated_(0), skipped_(0), failed_(false)
+{
+}
+
+DiskWriter::~DiskWriter()
+{
+	stop();
+}
+
+int DiskWriter::start()
+{
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	direct_ = true;
+	fd_ = open(filename_.c_str(), flags | O_DIRECT, 0644);
+	if (fd_ < 0 && errno == EINVAL) {
+		direct_ = false;
+		fd_ = open(filename_.c_str(), flags, 0644);
+	}
+
+	if (fd_ < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to open " << filename_ << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	if (!direct_)
+		std::cout << filename_ << ": direct I/O not supported, "
+			  << "using buffered writes" << std::endl;
+
+	bufferSize_ = alignUp(sizeof(FrameHeader) + frameSize_);
+	int ret = posix_memalign(reinterpret_cast<void **>(&buffer_),
+				 kAlignment, bufferSize_);
+	if (ret) {
+		buffer_ = nullptr;
+		close(fd_);
+		fd_ = -1;
+		return -ret;
+	}
+
+	frames_ = 0;
+	bytes_ = 0;
+	dropped_ = 0;
+	truncated_ = 0;
+	skipped_ = 0;
+	failed_ = false;
+
+	running_ = true;
+	thread_ = std::thread(&DiskWriter::run, this);
+
+	return 0;
+}
+
+/* All the frames queued so far are written before stopping. */
+void DiskWriter::stop()
+{
+	if (!thread_.joinable())
+		return;
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		running_ = false;
+	}
+
+	cond_.notify_one();
+	thread_.join();
+
+	std::cout << filename_ << ": wrote " << frames_ << " frames, "
+		  << bytes_ / 1000000 << " MB";
+	if (dropped_)
+		std::cout << ", dropped " << dropped_ << " frames";
+	if (truncated_)
+		std::cout << ", truncated " << truncated_ << " frames";
+	if (failed_)
+		std::cout << ", failed to write " << skipped_ << " frames";
+	std::cout << std::endl;
+
+	close(fd_);
+	fd_ = -1;
+
+	free(buffer_);
+	buffer_ = nullptr;
+}
+
+void DiskWriter::processFrame(Frame *frame)
+{
+	if (frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	/*
+	 * The queue is sized for all the buffers of the stream and can't
+	 * overflow, but don't stall the capture if it does.
+	 */
+	frame->acquire();
+	if (!queue_.push(std::move(frame))) {
+		dropped_++;
+		frame->release();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		pending_++;
+	}
+
+	cond_.notify_one();
+}
+
+void DiskWriter::run()
+{
+	for (;;) {
+		unsigned int count;
+
+		{
+			std::unique_lock<std::mutex> locker(lock_);
+			cond_.wait(locker, [&]() { return pending_ || !running_; });
+
+			count = pending_;
+			pending_ = 0;
+
+			if (!count && !running_)
+				break;
+		}
+
+		while (count--) {
+			Frame *frame;
+			if (!queue_.pop(&frame))
+				break;
+
+			write(frame);
+
+			/* The buffer can now be reused by the camera. */
+			frame->release();
+		}
+	}
+}
+
+/*
+ * Frames that don't fit in the bounce buffer are written without the planes
+ * that overflow it, and accounted as truncated. Writing stops at the first
+ * failure, and the file is truncated to the last complete frame.
+ */
+void DiskWriter::write(Frame *frame)
+{
+	if (failed_) {
+		skipped_++;
+		return;
+	}
+
+	const FrameMetadata &metadata = frame->metadata();
+	const Image &image = frame->image();
+
+	FrameHeader header = {};
+	memcpy(header.magic, kMagic, sizeof(header.magic));
+	header.sequence = metadata.sequence;
+	header.timestamp = metadata.timestamp;
+
+	size_t offset = sizeof(header);
+	bool truncated = false;
+
+	for (unsigned int i = 0; i < image.numPlanes(); ++i) {
+		size_t size = std::min<size_t>(metadata.planes()[i].bytesused,
+					       image.data(i).size());
+		if (i == FrameHeader::kMaxPlanes || offset + size > bufferSize_) {
+			truncated = true;
+			break;
+		}
+
+		memcpy(buffer_ + offset, image.data(i).data(), size);
+		header.bytesused[i] = size;
+		header.numPlanes++;
+		offset += size;
+	}
+
+	size_t size = alignUp(offset);
+	memset(buffer_ + offset, 0, size - offset);
+
+	header.size = size;
+	memcpy(buffer_, &header, sizeof(header));
+
+	if (truncated)
+		truncated_++;
+
+	for (size_t written = 0; written < size;) {
+		ssize_t ret = ::write(fd_, buffer_ + written, size - written);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			std::cerr << filename_ << ": write failed: "
+				  << strerror(errno) << std::endl;
+
+			if (written && ftruncate(fd_, bytes_) < 0)
+				std::cerr << filename_ << ": failed to drop partial frame: "
+					  << strerror(errno) << std::endl;
+
+			failed_ = true;
+			skipped_++;
+			return;
+		}
+
+		written += ret;
+	}
+
+	frames_++;
+	bytes_ += size;
+}
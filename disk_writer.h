@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * disk_writer.h - Frame sink streaming frames to disk
+ */
+#ifndef __SIMPLE_CAM_DISK_WRITER_H__
+#define __SIMPLE_CAM_DISK_WRITER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+#include "frame_sink.h"
+#include "mpsc_queue.h"
+
+/*
+ * The DiskWriter writes the frames of a stream to a file, from a background
+ * thread. Frames are held until they have been written, and only then
+ * released, which gives their buffer back to the camera.
+ *
+ * Each frame is stored as a fixed size header followed by the data of all
+ * its planes, padded to the alignment required for direct I/O.
+ */
+class DiskWriter : public FrameSink
+{
+public:
+	struct FrameHeader {
+		static constexpr unsigned int kMaxPlanes = 4;
+
+		char magic[4];
+		/* Size of the header, data and padding. */
+		uint32_t size;
+		uint32_t sequence;
+		uint32_t numPlanes;
+		uint64_t timestamp;
+		uint32_t bytesused[kMaxPlanes];
+	};
+
+	/*
+	 * The frame size is the maximum size of the image data of a frame,
+	 * and the queue size the maximum number of frames held at once.
+	 */
+	DiskWriter(const std::string &filename, size_t frameSize,
+		   size_t queueSize);
+	~DiskWriter();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+	bool failed() const override { return failed_; }
+
+private:
+	void run();
+	void write(Frame *frame);
+
+	std::string filename_;
+	size_t frameSize_;
+
+	MpscQueue<Frame *> queue_;
+	std::mutex lock_;
+	std::condition_variable cond_;
+	unsigned int pending_;
+	bool running_;
+	std::thread thread_;
+
+	int fd_;
+	bool direct_;
+	uint8_t *buffer_;
+	size_t bufferSize_;
+
+	uint64_t frames_;
+	uint64_t bytes_;
+	std::atomic<uint64_t> dropped_;
+	/* Frames larger than the frame size, and frames not written on failure. */
+	uint64_t truncated_;
+	uint64_t skipped_;
+	bool failed_;
+};
+
+#endif /* __SIMPLE_CAM_DISK_WRITER_H__ */
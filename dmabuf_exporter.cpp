@@ -0,0 +1,254 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * dmabuf_exporter.cpp - Frame sink sharing dmabufs with local processes
+ */
+
+#include "dmabuf_exporter.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace libcamera;
+
+DmabufExporter::DmabufExporter(EventLoop *loop, const std::string &path,
+			       const CameraConfiguration &config,
+			       const FrameBufferAllocator &allocator)
+	: loop_(loop), path_(path), fd_(-1), dropped_(0)
+{
+	for (unsigned int i = 0; i < config.size(); ++i) {
+		const StreamConfiguration &cfg = config.at(i);
+
+		for (const std::unique_ptr<FrameBuffer> &buffer : allocator.buffers(cfg.stream())) {
+			ExportedBuffer exported = {};
+			BufferMessage &msg = exported.message;
+
+			msg.type = BufferInfo;
+			msg.id = buffers_.size();
+			msg.stream = i;
+			msg.pixelFormat = cfg.pixelFormat.fourcc();
+			msg.width = cfg.size.width;
+			msg.height = cfg.size.height;
+			msg.stride = cfg.stride;
+
+			for (const FrameBuffer::Plane &plane : buffer->planes()) {
+				if (msg.numPlanes == kMaxPlanes)
+					break;
+
+				msg.offset[msg.numPlanes] = plane.offset;
+				msg.length[msg.numPlanes] = plane.length;
+				msg.numPlanes++;
+			}
+
+			exported.buffer = buffer.get();
+			ids_[buffer.get()] = msg.id;
+			buffers_.push_back(exported);
+		}
+	}
+}
+
+DmabufExporter::~DmabufExporter()
+{
+	stop();
+}
+
+int DmabufExporter::start()
+{
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+
+	if (path_.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "Socket path " << path_ << " too long" << std::endl;
+		return -ENAMETOOLONG;
+	}
+
+	memcpy(addr.sun_path, path_.c_str(), path_.size());
+
+	fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd_ < 0)
+		return -errno;
+
+	unlink(path_.c_str());
+
+	if (bind(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+	    listen(fd_, 8) < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to listen on " << path_ << ": "
+			  << strerror(-ret) << std::endl;
+		close(fd_);
+		fd_ = -1;
+		return ret;
+	}
+
+	loop_->addFdEvent(fd_, EventLoop::Read, [this]() { acceptClient(); });
+
+	std::cout << "Exporting frames on " << path_ << std::endl;
+
+	return 0;
+}
+
+void DmabufExporter::stop()
+{
+	if (fd_ < 0)
+		return;
+
+	while (!clients_.empty())
+		removeClient(clients_.front().get());
+
+	loop_->removeFdEvent(fd_);
+	close(fd_);
+	fd_ = -1;
+
+	unlink(path_.c_str());
+
+	if (dropped_)
+		std::cout << path_ << ": " << dropped_
+			  << " frames not delivered to busy consumers" << std::endl;
+}
+
+/*
+ * Hand a frame to all the connected consumers. Consumers that can't keep up
+ * and whose socket is full miss the frame, instead of stalling the capture.
+ */
+void DmabufExporter::processFrame(Frame *frame)
+{
+	if (clients_.empty() ||
+	    frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	auto iter = ids_.find(frame->buffer());
+	if (iter == ids_.end())
+		return;
+
+	const FrameRecord &record = frame->record();
+
+	FrameMessage msg = {};
+	msg.type = FrameReady;
+	msg.id = iter->second;
+	msg.sequence = record.sequence;
+	msg.timestamp = record.timestamp;
+	msg.numPlanes = std::min<unsigned int>(record.numPlanes, kMaxPlanes);
+	for (unsigned int i = 0; i < msg.numPlanes; ++i)
+		msg.bytesused[i] = record.bytesused[i];
+
+	for (std::unique_ptr<Client> &client : clients_) {
+		frame->acquire();
+
+		if (send(client->fd, &msg, sizeof(msg), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+			frame->release();
+			dropped_++;
+			continue;
+		}
+
+		client->frames[msg.id] = frame;
+	}
+}
+
+void DmabufExporter::acceptClient()
+{
+	int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	std::unique_ptr<Client> client = std::make_unique<Client>();
+	client->fd = fd;
+	client->frames.resize(buffers_.size());
+
+	int ret = sendBuffers(client.get());
+	if (ret < 0) {
+		std::cerr << path_ << ": Failed to export buffers: "
+			  << strerror(-ret) << std::endl;
+		close(fd);
+		return;
+	}
+
+	Client *c = client.get();
+	loop_->addFdEvent(fd, EventLoop::Read, [this, c]() { readClient(c); });
+	clients_.push_back(std::move(client));
+}
+
+/* Send the description and file descriptors of all the buffers. */
+int DmabufExporter::sendBuffers(Client *client)
+{
+	for (ExportedBuffer &exported : buffers_) {
+		const std::vector<FrameBuffer::Plane> &planes = exported.buffer->planes();
+		unsigned int numPlanes = exported.message.numPlanes;
+
+		char control[CMSG_SPACE(sizeof(int) * kMaxPlanes)] = {};
+		struct iovec iov = { &exported.message, sizeof(exported.message) };
+
+		struct msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * numPlanes);
+
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * numPlanes);
+
+		int *fds = reinterpret_cast<int *>(CMSG_DATA(cmsg));
+		for (unsigned int i = 0; i < numPlanes; ++i)
+			fds[i] = planes[i].fd.get();
+
+		/*
+		 * The buffer table is small, and fits in the socket buffer of
+		 * a newly connected client.
+		 */
+		if (sendmsg(client->fd, &msg, MSG_NOSIGNAL) < 0)
+			return -errno;
+	}
+
+	return 0;
+}
+
+void DmabufExporter::readClient(Client *client)
+{
+	for (;;) {
+		ReleaseMessage msg;
+		ssize_t ret = recv(client->fd, &msg, sizeof(msg), MSG_DONTWAIT);
+
+		if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+			return;
+
+		if (ret <= 0) {
+			removeClient(client);
+			return;
+		}
+
+		if (ret != sizeof(msg) || msg.id >= client->frames.size())
+			continue;
+
+		Frame *frame = client->frames[msg.id];
+		if (!frame || frame->record().sequence != msg.sequence)
+			continue;
+
+		client->frames[msg.id] = nullptr;
+		frame->release();
+	}
+}
+
+/* Release all the frames still held by a disconnected client. */
+void DmabufExporter::removeClient(Client *client)
+{
+	for (Frame *&frame : client->frames) {
+		if (frame) {
+			frame->release();
+			frame = nullptr;
+		}
+	}
+
+	loop_->removeFdEvent(client->fd);
+	close(client->fd);
+
+	clients_.remove_if([client](const std::unique_ptr<Client> &c) {
+		return c.get() == client;
+	});
+}
@@ -0,0 +1,113 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * dmabuf_exporter.h - Frame sink sharing dmabufs with local processes
+ */
+#ifndef __SIMPLE_CAM_DMABUF_EXPORTER_H__
+#define __SIMPLE_CAM_DMABUF_EXPORTER_H__
+
+#include <list>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/camera.h>
+#include <libcamera/framebuffer.h>
+#include <libcamera/framebuffer_allocator.h>
+
+#include "event_loop.h"
+#include "frame_sink.h"
+
+/*
+ * The DmabufExporter shares the captured frames with consumer processes
+ * connected to a UNIX socket, without copying the image data.
+ *
+ * When a consumer connects, it receives one BufferMessage per buffer, along
+ * with the dmabuf file descriptors of the buffer planes, and maps them once.
+ * For every captured frame, consumers then receive a FrameMessage that only
+ * identifies the buffer, and return a ReleaseMessage once done with it. The
+ * buffer is given back to the camera when all consumers have released it.
+ *
+ * The socket is a SOCK_SEQPACKET socket, each message is sent as a single
+ * packet. The socket is served by the event loop of the camera session.
+ */
+class DmabufExporter : public FrameSink
+{
+public:
+	static constexpr unsigned int kMaxPlanes = 4;
+
+	enum MessageType : uint32_t {
+		BufferInfo,
+		FrameReady,
+	};
+
+	struct BufferMessage {
+		uint32_t type;
+		uint32_t id;
+		uint32_t stream;
+		uint32_t pixelFormat;
+		uint32_t width;
+		uint32_t height;
+		uint32_t stride;
+		uint32_t numPlanes;
+		/* The file descriptors are sent in plane order. */
+		uint32_t offset[kMaxPlanes];
+		uint32_t length[kMaxPlanes];
+	};
+
+	struct FrameMessage {
+		uint32_t type;
+		uint32_t id;
+		uint32_t sequence;
+		uint32_t numPlanes;
+		uint64_t timestamp;
+		uint32_t bytesused[kMaxPlanes];
+	};
+
+	struct ReleaseMessage {
+		uint32_t id;
+		uint32_t sequence;
+	};
+
+	DmabufExporter(EventLoop *loop, const std::string &path,
+		       const libcamera::CameraConfiguration &config,
+		       const libcamera::FrameBufferAllocator &allocator);
+	~DmabufExporter();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+
+private:
+	struct ExportedBuffer {
+		const libcamera::FrameBuffer *buffer;
+		BufferMessage message;
+	};
+
+	struct Client {
+		int fd;
+		/* Frames held by the client, indexed by buffer ID. */
+		std::vector<Frame *> frames;
+	};
+
+	void acceptClient();
+	void readClient(Client *client);
+	void removeClient(Client *client);
+	int sendBuffers(Client *client);
+
+	EventLoop *loop_;
+	std::string path_;
+	int fd_;
+
+	std::vector<ExportedBuffer> buffers_;
+	std::map<const libcamera::FrameBuffer *, unsigned int> ids_;
+
+	std::list<std::unique_ptr<Client>> clients_;
+	uint64_t dropped_;
+};
+
+#endif /* __SIMPLE_CAM_DMABUF_EXPORTER_H__ */
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * drop_policy.cpp - Frame dropping policy for overloaded consumers
+ */
+
+#include "drop_policy.h"
+
+DropPolicy::DropPolicy(const Options &options)
+	: mode_(options.dropMode), skipInterval_(options.skipInterval),
+	  maxBacklog_(options.maxBacklog), skipped_(0), dropped_(0)
+{
+}
+
+/*
+ * Decide whether to hand a completed request to the consumers, given the
+ * number of newer completed requests waiting to be processed, and the
+ * largest number of frames of a stream held by the consumers.
+ */
+bool DropPolicy::admit(unsigned int waiting, unsigned int held)
+{
+	bool drop;
+
+	switch (mode_) {
+	case DropMode::DropOldest:
+		drop = waiting >= maxBacklog_;
+		break;
+
+	case DropMode::DropNewest:
+		drop = held >= maxBacklog_;
+		break;
+
+	case DropMode::Skip:
+		if (waiting < maxBacklog_ && held < maxBacklog_) {
+			skipped_ = 0;
+			drop = false;
+		} else {
+			drop = skipped_++ % skipInterval_ != 0;
+		}
+		break;
+
+	case DropMode::None:
+	default:
+		drop = false;
+		break;
+	}
+
+	if (drop)
+		dropped_++;
+
+	return !drop;
+}
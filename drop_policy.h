@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * drop_policy.h - Frame dropping policy for overloaded consumers
+ */
+#ifndef __SIMPLE_CAM_DROP_POLICY_H__
+#define __SIMPLE_CAM_DROP_POLICY_H__
+
+#include <stdint.h>
+
+#include "options.h"
+
+/*
+ * The DropPolicy decides which completed requests are handed to the
+ * consumers when they can't keep up with the camera. Dropped requests are
+ * requeued right away, so that the capture latency stays bounded instead of
+ * letting completed requests pile up, and the camera drop frames at random.
+ *
+ * The consumers are overloaded when the number of completed requests waiting
+ * to be processed, or the number of frames of a stream still held by the
+ * consumers, reaches the maximum backlog. The policy then either :
+ *
+ * - drops the oldest requests, those waiting to be processed while newer ones
+ *   have completed already,
+ * - drops the newest requests, while the consumers still hold older frames,
+ * - or only hands one request out of N to the consumers.
+ */
+class DropPolicy
+{
+public:
+	DropPolicy(const Options &options);
+
+	bool admit(unsigned int waiting, unsigned int held);
+
+	uint64_t dropped() const { return dropped_; }
+
+private:
+	DropMode mode_;
+	unsigned int skipInterval_;
+	unsigned int maxBacklog_;
+
+	unsigned int skipped_;
+	uint64_t dropped_;
+};
+
+#endif /* __SIMPLE_CAM_DROP_POLICY_H__ */
@@ -0,0 +1,491 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * encoder_sink.cpp - Frame sink encoding frames with a V4L2 M2M encoder
+ */
+
+#include "encoder_sink.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "clock.h"
+
+using namespace libcamera;
+
+namespace {
+
+/* Number of buffers receiving the encoded bitstream. */
+constexpr unsigned int kCaptureBuffers = 4;
+
+/* Time to wait for the encoder to drain when stopping. */
+constexpr int kDrainTimeoutMs = 1000;
+
+int xioctl(int fd, unsigned long request, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, request, arg);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : 0;
+}
+
+bool supportsFormat(int fd, enum v4l2_buf_type type, uint32_t fourcc)
+{
+	struct v4l2_fmtdesc desc = {};
+	desc.type = type;
+
+	while (!xioctl(fd, VIDIOC_ENUM_FMT, &desc)) {
+		if (desc.pixelformat == fourcc)
+			return true;
+		desc.index++;
+	}
+
+	return false;
+}
+
+} /* namespace */
+
+EncoderSink::EncoderSink(EventLoop *loop, const std::string &device,
+			 EncoderCodec codec, const std::string &filename,
+			 const StreamConfiguration &cfg,
+			 const std::vector<std::unique_ptr<FrameBuffer>> &buffers)
+	: loop_(loop), device_(device),
+	  codec_(codec == EncoderCodec::MJPEG ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_H264),
+	  filename_(filename), format_(cfg.pixelFormat), size_(cfg.size),
+	  stride_(cfg.stride), frameSize_(cfg.frameSize), fd_(-1), file_(-1),
+	  queued_(0), eos_(false), frames_(0), bytes_(0), dropped_(0)
+{
+	for (const std::unique_ptr<FrameBuffer> &buffer : buffers) {
+		ids_[buffer.get()] = outputs_.size();
+		outputs_.push_back({ buffer.get(), -1, 0, 0, nullptr });
+	}
+}
+
+EncoderSink::~EncoderSink()
+{
+	stop();
+}
+
+/* Find a memory-to-memory device encoding to the codec. */
+std::string EncoderSink::findEncoder(uint32_t codec)
+{
+	for (unsigned int i = 0; i < 64; ++i) {
+		std::string path = "/dev/video" + std::to_string(i);
+		int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+
+		struct v4l2_capability caps = {};
+		bool found = !xioctl(fd, VIDIOC_QUERYCAP, &caps) &&
+			     (caps.device_caps & V4L2_CAP_VIDEO_M2M_MPLANE) &&
+			     supportsFormat(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, codec);
+
+		close(fd);
+
+		if (found)
+			return path;
+	}
+
+	return {};
+}
+
+int EncoderSink::start()
+{
+	std::string device = device_.empty() ? findEncoder(codec_) : device_;
+	if (device.empty()) {
+		std::cerr << "No V4L2 encoder found" << std::endl;
+		return -ENODEV;
+	}
+
+	fd_ = open(device.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd_ < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to open encoder " << device << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	int ret = configure();
+	if (ret < 0) {
+		release();
+		return ret;
+	}
+
+	file_ = open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+		     0644);
+	if (file_ < 0) {
+		ret = -errno;
+		std::cerr << "Failed to open " << filename_ << ": "
+			  << strerror(-ret) << std::endl;
+		release();
+		return ret;
+	}
+
+	int type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	ret = xioctl(fd_, VIDIOC_STREAMON, &type);
+	if (!ret) {
+		type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		ret = xioctl(fd_, VIDIOC_STREAMON, &type);
+	}
+	if (ret < 0) {
+		std::cerr << "Failed to start encoder: " << strerror(-ret)
+			  << std::endl;
+		release();
+		return ret;
+	}
+
+	/*
+	 * The encoder signals POLLOUT when it is done reading a frame, and
+	 * POLLIN when encoded data is available.
+	 */
+	loop_->addFdEvent(fd_, static_cast<EventLoop::EventType>(EventLoop::Read | EventLoop::Write),
+			  [this]() { handleEvent(); });
+
+	std::cout << filename_ << ": encoding with " << device << std::endl;
+
+	return 0;
+}
+
+int EncoderSink::configure()
+{
+	/*
+	 * The encoder imports each buffer as a single plane, at the offset
+	 * of its first plane in the dmabuf.
+	 */
+	for (OutputBuffer &output : outputs_) {
+		const std::vector<FrameBuffer::Plane> &planes = output.buffer->planes();
+
+		output.fd = planes[0].fd.get();
+		output.offset = planes[0].offset;
+		output.length = planes[0].offset;
+
+		for (const FrameBuffer::Plane &plane : planes) {
+			if (plane.fd.get() != output.fd || plane.offset != output.length) {
+				std::cerr << "Encoder requires contiguous planes"
+					  << std::endl;
+				return -EINVAL;
+			}
+
+			output.length += plane.length;
+		}
+	}
+
+	/*
+	 * The coded format is set first, as it determines the raw formats the
+	 * encoder accepts. The raw format is then checked once set, as the
+	 * encoder may adjust it to the coded format.
+	 */
+	struct v4l2_format fmt = {};
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	fmt.fmt.pix_mp.width = size_.width;
+	fmt.fmt.pix_mp.height = size_.height;
+	fmt.fmt.pix_mp.pixelformat = codec_;
+	fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+	fmt.fmt.pix_mp.num_planes = 1;
+	fmt.fmt.pix_mp.plane_fmt[0].sizeimage = frameSize_;
+
+	int ret = xioctl(fd_, VIDIOC_S_FMT, &fmt);
+	if (ret < 0 || fmt.fmt.pix_mp.pixelformat != codec_) {
+		std::cerr << "Encoder doesn't support the codec" << std::endl;
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	fmt = {};
+	fmt.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	fmt.fmt.pix_mp.width = size_.width;
+	fmt.fmt.pix_mp.height = size_.height;
+	fmt.fmt.pix_mp.pixelformat = format_.fourcc();
+	fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+	fmt.fmt.pix_mp.num_planes = 1;
+	fmt.fmt.pix_mp.plane_fmt[0].bytesperline = stride_;
+	fmt.fmt.pix_mp.plane_fmt[0].sizeimage = frameSize_;
+
+	ret = xioctl(fd_, VIDIOC_S_FMT, &fmt);
+	if (ret < 0 || fmt.fmt.pix_mp.pixelformat != format_.fourcc() ||
+	    fmt.fmt.pix_mp.width != size_.width ||
+	    fmt.fmt.pix_mp.height != size_.height ||
+	    fmt.fmt.pix_mp.num_planes != 1 ||
+	    fmt.fmt.pix_mp.plane_fmt[0].bytesperline != stride_) {
+		std::cerr << "Encoder can't import " << format_.toString() << " "
+			  << size_.toString() << " frames with stride " << stride_
+			  << std::endl;
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	/* One output buffer per captured buffer, so frames never wait. */
+	struct v4l2_requestbuffers reqbufs = {};
+	reqbufs.count = outputs_.size();
+	reqbufs.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	reqbufs.memory = V4L2_MEMORY_DMABUF;
+
+	ret = xioctl(fd_, VIDIOC_REQBUFS, &reqbufs);
+	if (ret < 0 || reqbufs.count < outputs_.size()) {
+		std::cerr << "Failed to allocate encoder input buffers" << std::endl;
+		return ret < 0 ? ret : -ENOMEM;
+	}
+
+	reqbufs = {};
+	reqbufs.count = kCaptureBuffers;
+	reqbufs.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	reqbufs.memory = V4L2_MEMORY_MMAP;
+
+	ret = xioctl(fd_, VIDIOC_REQBUFS, &reqbufs);
+	if (ret < 0 || !reqbufs.count) {
+		std::cerr << "Failed to allocate encoder output buffers" << std::endl;
+		return ret < 0 ? ret : -ENOMEM;
+	}
+
+	for (unsigned int i = 0; i < reqbufs.count; ++i) {
+		struct v4l2_plane plane = {};
+		struct v4l2_buffer buf = {};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		buf.length = 1;
+		buf.m.planes = &plane;
+
+		ret = xioctl(fd_, VIDIOC_QUERYBUF, &buf);
+		if (ret < 0)
+			return ret;
+
+		void *data = mmap(nullptr, plane.length, PROT_READ, MAP_SHARED,
+				  fd_, plane.m.mem_offset);
+		if (data == MAP_FAILED)
+			return -errno;
+
+		captures_.push_back({ data, plane.length });
+
+		ret = queueCapture(i);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+int EncoderSink::queueCapture(unsigned int index)
+{
+	struct v4l2_plane plane = {};
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	buf.length = 1;
+	buf.m.planes = &plane;
+
+	return xioctl(fd_, VIDIOC_QBUF, &buf);
+}
+
+void EncoderSink::processFrame(Frame *frame)
+{
+	if (fd_ < 0 || frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	auto iter = ids_.find(frame->buffer());
+	if (iter == ids_.end())
+		return;
+
+	unsigned int index = iter->second;
+	OutputBuffer &output = outputs_[index];
+	const FrameRecord &record = frame->record();
+
+	unsigned int bytesused = output.offset;
+	for (unsigned int i = 0; i < record.numPlanes; ++i)
+		bytesused += record.bytesused[i];
+
+	/*
+	 * The timestamp is copied by the encoder to the encoded frame, and is
+	 * used to measure the encoding latency.
+	 */
+	uint64_t now = monotonicNs();
+
+	struct v4l2_plane plane = {};
+	plane.m.fd = output.fd;
+	plane.length = output.length;
+	plane.bytesused = std::min(bytesused, output.length);
+	plane.data_offset = output.offset;
+
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	buf.memory = V4L2_MEMORY_DMABUF;
+	buf.index = index;
+	buf.field = V4L2_FIELD_NONE;
+	buf.timestamp.tv_sec = now / 1000000000;
+	buf.timestamp.tv_usec = now / 1000 % 1000000;
+	buf.length = 1;
+	buf.m.planes = &plane;
+
+	frame->acquire();
+
+	if (xioctl(fd_, VIDIOC_QBUF, &buf) < 0) {
+		frame->release();
+		dropped_++;
+		return;
+	}
+
+	output.frame = frame;
+	queueDepth_.record(++queued_);
+}
+
+void EncoderSink::handleEvent()
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	/* Give the frames the encoder is done with back to the camera. */
+	for (;;) {
+		plane = {};
+		buf = {};
+		buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+		buf.memory = V4L2_MEMORY_DMABUF;
+		buf.length = 1;
+		buf.m.planes = &plane;
+
+		if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0)
+			break;
+
+		OutputBuffer &output = outputs_[buf.index];
+		Frame *frame = output.frame;
+		output.frame = nullptr;
+		queued_--;
+
+		if (frame)
+			frame->release();
+	}
+
+	/*
+	 * Write the encoded frames. The bitstream is a small fraction of
+	 * the raw data, and is written from the event loop directly.
+	 */
+	for (;;) {
+		plane = {};
+		buf = {};
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.length = 1;
+		buf.m.planes = &plane;
+
+		if (xioctl(fd_, VIDIOC_DQBUF, &buf) < 0)
+			break;
+
+		const CaptureBuffer &capture = captures_[buf.index];
+		size_t offset = std::min<size_t>(plane.data_offset, plane.bytesused);
+		size_t size = std::min<size_t>(plane.bytesused, capture.length) - offset;
+
+		if (size) {
+			uint64_t queued = buf.timestamp.tv_sec * 1000000000ULL
+					+ buf.timestamp.tv_usec * 1000ULL;
+			latency_.record(monotonicNs() - queued);
+
+			const uint8_t *data = static_cast<const uint8_t *>(capture.data);
+			if (write(file_, data + offset, size) != static_cast<ssize_t>(size))
+				std::cerr << filename_ << ": write failed" << std::endl;
+
+			frames_++;
+			bytes_ += size;
+		}
+
+		if (buf.flags & V4L2_BUF_FLAG_LAST) {
+			eos_ = true;
+			break;
+		}
+
+		queueCapture(buf.index);
+	}
+}
+
+/* Encode the frames already queued before stopping the encoder. */
+void EncoderSink::drain()
+{
+	struct v4l2_encoder_cmd cmd = {};
+	cmd.cmd = V4L2_ENC_CMD_STOP;
+
+	if (xioctl(fd_, VIDIOC_ENCODER_CMD, &cmd) < 0)
+		return;
+
+	uint64_t deadline = monotonicNs() + kDrainTimeoutMs * 1000000ULL;
+
+	while (!eos_) {
+		uint64_t now = monotonicNs();
+		if (now >= deadline)
+			break;
+
+		struct pollfd pfd = { fd_, POLLIN | POLLOUT, 0 };
+		if (poll(&pfd, 1, (deadline - now) / 1000000 + 1) <= 0)
+			break;
+
+		handleEvent();
+	}
+}
+
+void EncoderSink::stop()
+{
+	if (fd_ < 0)
+		return;
+
+	if (file_ >= 0) {
+		loop_->removeFdEvent(fd_);
+		drain();
+	}
+
+	release();
+
+	std::cout << filename_ << ": encoded " << frames_ << " frames, "
+		  << bytes_ / 1000 << " kB";
+	if (dropped_)
+		std::cout << ", dropped " << dropped_ << " frames";
+	std::cout << std::endl;
+
+	if (latency_.count())
+		std::cout << filename_ << ": queue depth mean " << std::fixed
+			  << std::setprecision(1) << queueDepth_.mean()
+			  << " max " << queueDepth_.max() << ", latency p50 "
+			  << std::setprecision(3)
+			  << latency_.percentile(50) / 1000000.0 << " p99 "
+			  << latency_.percentile(99) / 1000000.0 << " max "
+			  << latency_.max() / 1000000.0 << " ms"
+			  << std::defaultfloat << std::endl;
+}
+
+/* Stop the encoder, and release the frames it still holds. */
+void EncoderSink::release()
+{
+	int type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	xioctl(fd_, VIDIOC_STREAMOFF, &type);
+	type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	xioctl(fd_, VIDIOC_STREAMOFF, &type);
+
+	for (OutputBuffer &output : outputs_) {
+		if (output.frame) {
+			output.frame->release();
+			output.frame = nullptr;
+		}
+	}
+
+	queued_ = 0;
+
+	for (const CaptureBuffer &capture : captures_)
+		munmap(capture.data, capture.length);
+	captures_.clear();
+
+	close(fd_);
+	fd_ = -1;
+
+	if (file_ >= 0) {
+		close(file_);
+		file_ = -1;
+	}
+}
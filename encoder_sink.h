@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * encoder_sink.h - Frame sink encoding frames with a V4L2 M2M encoder
+ */
+#ifndef __SIMPLE_CAM_ENCODER_SINK_H__
+#define __SIMPLE_CAM_ENCODER_SINK_H__
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/geometry.h>
+#include <libcamera/pixel_format.h>
+#include <libcamera/stream.h>
+
+#include "event_loop.h"
+#include "frame_sink.h"
+#include "histogram.h"
+#include "options.h"
+
+/*
+ * The EncoderSink compresses the frames of a stream to H.264 or MJPEG with a
+ * V4L2 memory-to-memory encoder, and writes the bitstream to a file.
+ *
+ * The dmabufs of the captured buffers are imported directly in the output
+ * queue of the encoder, without any copy. This requires the planes of each
+ * buffer to be stored contiguously in a single dmabuf, and the encoder to
+ * accept the pixel format and stride of the stream as-is.
+ *
+ * Encoding runs asynchronously: frames are queued to the encoder and
+ * released as soon as the encoder is done reading them, so that the request
+ * can be requeued to the camera without waiting for the encoded data. The
+ * encoder is served by the event loop of the camera session.
+ */
+class EncoderSink : public FrameSink
+{
+public:
+	EncoderSink(EventLoop *loop, const std::string &device, EncoderCodec codec,
+		    const std::string &filename,
+		    const libcamera::StreamConfiguration &cfg,
+		    const std::vector<std::unique_ptr<libcamera::FrameBuffer>> &buffers);
+	~EncoderSink();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+
+private:
+	struct OutputBuffer {
+		const libcamera::FrameBuffer *buffer;
+		int fd;
+		unsigned int offset;
+		unsigned int length;
+		Frame *frame;
+	};
+
+	struct CaptureBuffer {
+		void *data;
+		size_t length;
+	};
+
+	static std::string findEncoder(uint32_t codec);
+
+	int configure();
+	int queueCapture(unsigned int index);
+	void handleEvent();
+	void drain();
+	void release();
+
+	EventLoop *loop_;
+	std::string device_;
+	uint32_t codec_;
+	std::string filename_;
+	libcamera::PixelFormat format_;
+	libcamera::Size size_;
+	unsigned int stride_;
+	unsigned int frameSize_;
+
+	int fd_;
+	int file_;
+
+	std::vector<OutputBuffer> outputs_;
+	std::map<const libcamera::FrameBuffer *, unsigned int> ids_;
+	std::vector<CaptureBuffer> captures_;
+
+	/* Number of frames queued to the encoder and not released yet. */
+	unsigned int queued_;
+	bool eos_;
+
+	uint64_t frames_;
+	uint64_t bytes_;
+	uint64_t dropped_;
+	Histogram queueDepth_;
+	Histogram latency_;
+};
+
+#endif /* __SIMPLE_CAM_ENCODER_SINK_H__ */
@@ -7,27 +7,62 @@
 
 #include "event_loop.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <event2/event.h>
 #include <event2/thread.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
-EventLoop *EventLoop::instance_ = nullptr;
+/*
+ * Several event loops can run concurrently in different threads. libevent is
+ * set up for threading when the first one is created, and shut down when the
+ * last one is destroyed.
+ */
+static std::mutex instancesLock;
+static unsigned int instances = 0;
 
-EventLoop::EventLoop()
+EventLoop::EventLoop(size_t queueSize)
+	: calls_(queueSize), hasOverflow_(false), wakeupPending_(false)
 {
-	assert(!instance_);
+	{
+		std::unique_lock<std::mutex> locker(instancesLock);
+		if (!instances++)
+			evthread_use_pthreads();
+	}
 
-	evthread_use_pthreads();
-	event_ = event_base_new();
-	instance_ = this;
+	/*
+	 * libevent measures time with the coarse monotonic clock by default,
+	 * which delays timers by up to a scheduler tick. Frames are replayed
+	 * from timers, use the precise clock.
+	 */
+	struct event_config *config = event_config_new();
+	event_config_set_flag(config, EVENT_BASE_FLAG_PRECISE_TIMER);
+	event_ = event_base_new_with_config(config);
+	event_config_free(config);
+
+	wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	assert(wakeupFd_ >= 0);
+
+	wakeupEvent_ = event_new(event_, wakeupFd_, EV_READ | EV_PERSIST,
+				 &wakeupTriggered, this);
+	event_add(wakeupEvent_, nullptr);
 }
 
 EventLoop::~EventLoop()
 {
-	instance_ = nullptr;
+	fdEvents_.clear();
+	timers_.clear();
+
+	event_free(wakeupEvent_);
+	close(wakeupFd_);
 
 	event_base_free(event_);
-	libevent_global_shutdown();
+
+	std::unique_lock<std::mutex> locker(instancesLock);
+	if (!--instances)
+		libevent_global_shutdown();
 }
 
 int EventLoop::exec()
@@ -52,48 +87,335 @@ void EventLoop::exit(int code)
 
 void EventLoop::interrupt()
 {
-	event_base_loopbreak(event_);
-}
+	/*
+	 * Only the first call queued after the event loop has consumed the
+	 * previous wakeup needs to signal the eventfd. All calls queued in a
+	 * burst are then handled by a single dispatchCalls() pass.
+	 */
+	if (wakeupPending_.exchange(true, std::memory_order_acq_rel))
+		return;
 
+	uint64_t value = 1;
+	ssize_t ret = write(wakeupFd_, &value, sizeof(value));
+	(void)ret;
+}
 
-void EventLoop::timeoutTriggered(int fd, short event, void *arg)
+void EventLoop::wakeupTriggered(int fd, short event, void *arg)
 {
 	EventLoop *self = static_cast<EventLoop *>(arg);
-	self->exit();
+	uint64_t value;
+
+	ssize_t ret = read(fd, &value, sizeof(value));
+	(void)ret;
+
+	/*
+	 * Clear the pending flag before dispatching, so that calls queued
+	 * while dispatching signal a new wakeup. The exchange synchronizes
+	 * with the producers, making all calls queued so far visible.
+	 */
+	self->wakeupPending_.exchange(false, std::memory_order_acq_rel);
+
+	if (self->exit_.load(std::memory_order_acquire)) {
+		event_base_loopbreak(self->event_);
+		return;
+	}
+
+	self->dispatchCalls();
 }
 
+/* Exit the event loop after a number of seconds. */
 void EventLoop::timeout(unsigned int sec)
 {
-	struct event *ev;
-	struct timeval tv;
+	addTimer(std::chrono::seconds(sec), [this]() { exit(); });
+}
+
+void EventLoop::callLater(Callable &&func)
+{
+	/*
+	 * The calls_ ring is lock-free and pre-allocated, so queuing a call from
+	 * the camera manager thread never allocates or contends with the event
+	 * loop thread. Should the ring ever fill up, fall back to the overflow
+	 * list instead of dropping the call. Calls keep being queued to the
+	 * overflow list until it has been drained, to run them in order.
+	 */
+	if (hasOverflow_.load(std::memory_order_acquire) ||
+	    !calls_.push(std::move(func))) {
+		std::unique_lock<std::mutex> locker(lock_);
+		overflow_.push_back(std::move(func));
+		hasOverflow_.store(true, std::memory_order_release);
+	}
 
-	tv.tv_sec = sec;
-	tv.tv_usec = 0;
-	ev = evtimer_new(event_, &timeoutTriggered, this);
-	evtimer_add(ev, &tv);
+	interrupt();
 }
 
-void EventLoop::callLater(const std::function<void()> &func)
+/*
+ * Call the handler every time the file descriptor becomes readable or
+ * writable, until the event is removed. Events can be added and removed from
+ * any thread, including from their own handler.
+ */
+void EventLoop::addFdEvent(int fd, EventType type, Callable &&handler)
 {
+	std::unique_ptr<FdEvent> fdEvent = std::make_unique<FdEvent>();
+	short events = fdEventFlags(type);
+
+	fdEvent->fd = fd;
+	fdEvent->handler = std::move(handler);
+	fdEvent->event = event_new(event_, fd, events, &fdEventTriggered,
+				   fdEvent.get());
+	event_add(fdEvent->event, nullptr);
+
+	std::unique_lock<std::mutex> locker(lock_);
+	fdEvents_.push_back(std::move(fdEvent));
+}
+
+/*
+ * Change the events watched on a file descriptor in place, keeping its
+ * handler. Unlike removing and adding the event again, this doesn't allocate
+ * memory, and can be used from the frame processing path.
+ */
+void EventLoop::setFdEventType(int fd, EventType type)
+{
+	std::unique_lock<std::mutex> locker(lock_);
+	auto iter = std::find_if(fdEvents_.begin(), fdEvents_.end(),
+				 [fd](const std::unique_ptr<FdEvent> &e) {
+					 return e->fd == fd;
+				 });
+	if (iter == fdEvents_.end())
+		return;
+
+	FdEvent *fdEvent = iter->get();
+	event_del(fdEvent->event);
+	event_assign(fdEvent->event, event_, fd, fdEventFlags(type),
+		     &fdEventTriggered, fdEvent);
+	event_add(fdEvent->event, nullptr);
+}
+
+void EventLoop::removeFdEvent(int fd)
+{
+	std::unique_ptr<FdEvent> fdEvent;
+
 	{
 		std::unique_lock<std::mutex> locker(lock_);
-		calls_.push_back(func);
+		auto iter = std::find_if(fdEvents_.begin(), fdEvents_.end(),
+					 [fd](const std::unique_ptr<FdEvent> &e) {
+						 return e->fd == fd;
+					 });
+		if (iter == fdEvents_.end())
+			return;
+
+		fdEvent = std::move(*iter);
+		fdEvents_.erase(iter);
 	}
 
-	interrupt();
+	/*
+	 * Stop watching the file descriptor right away, but defer destroying
+	 * the handler, which may be running.
+	 */
+	event_free(fdEvent->event);
+	fdEvent->event = nullptr;
+	callLater([fdEvent = std::move(fdEvent)]() {});
 }
 
-void EventLoop::dispatchCalls()
+/*
+ * Call the handler once after the delay, or periodically at the interval,
+ * until the timer is cancelled. Timers can be added and cancelled from any
+ * thread, including from their own handler, and their handlers run in the
+ * event loop thread.
+ *
+ * Timers are taken from a pool, and are only allocated when the pool is
+ * empty, so creating and cancelling timers is cheap. Periodic timers with
+ * the same interval share a libevent common timeout queue, which makes
+ * rearming them O(1). One-shot timers, whose delays are usually all
+ * different deadlines, use plain timeouts, as libevent supports a limited
+ * number of common timeout durations.
+ */
+EventLoop::TimerId EventLoop::addTimer(std::chrono::microseconds delay,
+				       Callable &&handler)
+{
+	return startTimer(delay, false, std::move(handler));
+}
+
+EventLoop::TimerId EventLoop::addPeriodicTimer(std::chrono::microseconds interval,
+					       Callable &&handler)
+{
+	return startTimer(interval, true, std::move(handler));
+}
+
+/*
+ * Cancel a timer. Cancelling a one-shot timer that has already fired, or a
+ * timer that has already been cancelled, is a no-op.
+ */
+void EventLoop::cancelTimer(TimerId id)
+{
+	uint32_t index = (id & 0xffffffff) - 1;
+	uint32_t generation = id >> 32;
+	Timer *timer;
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		if (index >= timers_.size() || !timers_[index]->active ||
+		    timers_[index]->generation != generation)
+			return;
+
+		/* Invalidate the handle, releasing the timer is now up to us. */
+		timer = timers_[index].get();
+		timer->active = false;
+		timer->generation++;
+	}
+
+	/*
+	 * Stop the timer right away, but defer releasing it, as its handler
+	 * may be running.
+	 */
+	event_del(timer->event);
+	callLater([this, timer]() { releaseTimer(timer); });
+}
+
+EventLoop::TimerId EventLoop::startTimer(std::chrono::microseconds duration,
+					 bool periodic, Callable &&handler)
+{
+	struct timeval tv;
+	tv.tv_sec = duration.count() / 1000000;
+	tv.tv_usec = duration.count() % 1000000;
+
+	Timer *timer;
+	TimerId id;
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+
+		if (freeTimers_.empty()) {
+			std::unique_ptr<Timer> newTimer = std::make_unique<Timer>();
+			newTimer->loop = this;
+			newTimer->index = timers_.size();
+			newTimer->generation = 1;
+			newTimer->event = event_new(event_, -1, 0, &timerTriggered,
+						    newTimer.get());
+
+			freeTimers_.push_back(newTimer.get());
+			timers_.push_back(std::move(newTimer));
+		}
+
+		timer = freeTimers_.back();
+		freeTimers_.pop_back();
+
+		timer->active = true;
+		timer->periodic = periodic;
+		timer->handler = std::move(handler);
+
+		id = (static_cast<TimerId>(timer->generation) << 32) | (timer->index + 1);
+	}
+
+	const struct timeval *timeout = nullptr;
+	if (periodic)
+		timeout = event_base_init_common_timeout(event_, &tv);
+	if (!timeout)
+		timeout = &tv;
+
+	event_assign(timer->event, event_, -1, periodic ? EV_PERSIST : 0,
+		     &timerTriggered, timer);
+	event_add(timer->event, timeout);
+
+	return id;
+}
+
+void EventLoop::releaseTimer(Timer *timer)
 {
+	timer->handler.reset();
+
 	std::unique_lock<std::mutex> locker(lock_);
+	freeTimers_.push_back(timer);
+}
 
-	for (auto iter = calls_.begin(); iter != calls_.end(); ) {
-		std::function<void()> call = std::move(*iter);
+void EventLoop::timerTriggered(int fd, short event, void *arg)
+{
+	Timer *timer = static_cast<Timer *>(arg);
+	EventLoop *self = timer->loop;
 
-		iter = calls_.erase(iter);
+	if (timer->periodic) {
+		timer->handler();
+		return;
+	}
 
-		locker.unlock();
+	/*
+	 * Invalidate the handle of one-shot timers before calling the
+	 * handler, to make cancelling them from the handler a no-op. If the
+	 * timer is being cancelled concurrently, the cancellation releases
+	 * it.
+	 */
+	{
+		std::unique_lock<std::mutex> locker(self->lock_);
+		if (!timer->active)
+			return;
+
+		timer->active = false;
+		timer->generation++;
+	}
+
+	timer->handler();
+	self->releaseTimer(timer);
+}
+
+EventLoop::Timer::~Timer()
+{
+	if (event)
+		event_free(event);
+}
+
+short EventLoop::fdEventFlags(EventType type)
+{
+	short events = EV_PERSIST;
+
+	if (type & Read)
+		events |= EV_READ;
+	if (type & Write)
+		events |= EV_WRITE;
+
+	return events;
+}
+
+void EventLoop::fdEventTriggered(int fd, short event, void *arg)
+{
+	FdEvent *fdEvent = static_cast<FdEvent *>(arg);
+	fdEvent->handler();
+}
+
+EventLoop::FdEvent::~FdEvent()
+{
+	if (event)
+		event_free(event);
+}
+
+void EventLoop::dispatchCalls()
+{
+	Callable call;
+
+	while (calls_.pop(&call)) {
 		call();
-		locker.lock();
+		call.reset();
+	}
+
+	if (!hasOverflow_.load(std::memory_order_acquire))
+		return;
+
+	/*
+	 * The calls queued while running the overflow list are queued to it
+	 * too, and run first. The ring is used again only once the list is
+	 * empty.
+	 */
+	for (;;) {
+		std::list<Callable> overflow;
+		{
+			std::unique_lock<std::mutex> locker(lock_);
+			if (overflow_.empty()) {
+				hasOverflow_.store(false, std::memory_order_relaxed);
+				return;
+			}
+
+			overflow.splice(overflow.end(), overflow_);
+		}
+
+		for (Callable &func : overflow)
+			func();
 	}
 }
@@ -8,36 +8,111 @@
 #define __SIMPLE_CAM_EVENT_LOOP_H__
 
 #include <atomic>
-#include <functional>
+#include <chrono>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
 
+#include "callable.h"
+#include "mpsc_queue.h"
+
+struct event;
 struct event_base;
 
 class EventLoop
 {
 public:
-	EventLoop();
+	enum EventType {
+		Read = 1,
+		Write = 2,
+	};
+
+	EventLoop(size_t queueSize = 256);
 	~EventLoop();
 
 	void exit(int code = 0);
 	int exec();
 
+	/* Timers are identified by a handle, zero is never a valid handle. */
+	using TimerId = uint64_t;
+
 	void timeout(unsigned int sec);
-	void callLater(const std::function<void()> &func);
+	void callLater(Callable &&func);
+
+	TimerId addTimer(std::chrono::microseconds delay, Callable &&handler);
+	TimerId addPeriodicTimer(std::chrono::microseconds interval,
+				 Callable &&handler);
+	void cancelTimer(TimerId id);
+
+	void addFdEvent(int fd, EventType type, Callable &&handler);
+	void setFdEventType(int fd, EventType type);
+	void removeFdEvent(int fd);
+
+	/* The libevent base, to serve libevent-based protocols from the loop. */
+	struct event_base *base() const { return event_; }
 
 private:
-	static EventLoop *instance_;
+	struct FdEvent {
+		~FdEvent();
+
+		int fd;
+		Callable handler;
+		struct event *event;
+	};
 
-	static void timeoutTriggered(int fd, short event, void *arg);
+	struct Timer {
+		~Timer();
+
+		EventLoop *loop;
+		uint32_t index;
+		uint32_t generation;
+		bool active;
+		bool periodic;
+		Callable handler;
+		struct event *event;
+	};
+
+	TimerId startTimer(std::chrono::microseconds duration, bool periodic,
+			   Callable &&handler);
+	void releaseTimer(Timer *timer);
+
+	static void timerTriggered(int fd, short event, void *arg);
+	static void wakeupTriggered(int fd, short event, void *arg);
+	static void fdEventTriggered(int fd, short event, void *arg);
+	static short fdEventFlags(EventType type);
 
 	struct event_base *event_;
 	std::atomic<bool> exit_;
 	int exitCode_;
 
-	std::list<std::function<void()>> calls_;
+	MpscQueue<Callable> calls_;
+
+	/* Only used when the calls_ ring is full. */
+	std::list<Callable> overflow_;
+	std::atomic<bool> hasOverflow_;
 	std::mutex lock_;
 
+	/*
+	 * Wakeups are signalled through an eventfd watched by the event_base,
+	 * and only when no wakeup is already pending.
+	 */
+	int wakeupFd_;
+	struct event *wakeupEvent_;
+	std::atomic<bool> wakeupPending_;
+
+	/* Watched file descriptors, protected by lock_. */
+	std::list<std::unique_ptr<FdEvent>> fdEvents_;
+
+	/*
+	 * Pool of timers, protected by lock_. Timers are only destroyed with
+	 * the event loop, and are otherwise recycled through the free list.
+	 */
+	std::vector<std::unique_ptr<Timer>> timers_;
+	std::vector<Timer *> freeTimers_;
+
 	void interrupt();
 	void dispatchCalls();
 };
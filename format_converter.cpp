@@ -0,0 +1,500 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * format_converter.cpp - YUV to RGB and greyscale pixel format conversion
+ */
+
+#include "format_converter.h"
+
+#include <string.h>
+
+#include <libcamera/formats.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON_KERNELS 1
+#endif
+
+using namespace libcamera;
+
+namespace {
+
+/*
+ * The BT.601 limited range coefficients are scaled by 64, which keeps all
+ * intermediate values within 16 bits for the SIMD kernels:
+ *
+ * B = (74 * (Y - 16) + 129 * (U - 128) + 32) >> 6
+ * G = (74 * (Y - 16) - 25 * (U - 128) - 52 * (V - 128) + 32) >> 6
+ * R = (74 * (Y - 16) + 102 * (V - 128) + 32) >> 6
+ *
+ * The only intermediate value that can exceed 16 bits is a blue value above
+ * 511, which the SIMD kernels saturate before clamping it to 255.
+ */
+enum class Output {
+	RGB888,
+	XRGB8888,
+	R8,
+};
+
+inline uint8_t clamp8(int value)
+{
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* RGB888 and XRGB8888 are stored in B, G, R(, X) order in memory. */
+template<Output output>
+inline void storePixel(uint8_t *dst, int y, int u, int v)
+{
+	int c = 74 * (y - 16) + 32;
+	int d = u - 128;
+	int e = v - 128;
+
+	dst[0] = clamp8((c + 129 * d) >> 6);
+	dst[1] = clamp8((c - 25 * d - 52 * e) >> 6);
+	dst[2] = clamp8((c + 102 * e) >> 6);
+
+	if constexpr (output == Output::XRGB8888)
+		dst[3] = 0xff;
+}
+
+template<Output output>
+constexpr unsigned int bytesPerPixel()
+{
+	return output == Output::XRGB8888 ? 4 : output == Output::RGB888 ? 3 : 1;
+}
+
+/* -----------------------------------------------------------------------------
+ * Scalar kernels
+ */
+
+template<Output output>
+void packedRowScalar(const uint8_t *src, uint8_t *dst, unsigned int width,
+		     unsigned int x = 0)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+
+	for (; x < width; x += 2) {
+		const uint8_t *yuyv = src + x * 2;
+
+		if constexpr (output == Output::R8) {
+			dst[x] = yuyv[0];
+			dst[x + 1] = yuyv[2];
+		} else {
+			storePixel<output>(dst + x * bpp, yuyv[0], yuyv[1], yuyv[3]);
+			storePixel<output>(dst + (x + 1) * bpp, yuyv[2], yuyv[1], yuyv[3]);
+		}
+	}
+}
+
+template<Output output>
+void semiPlanarRowScalar(const uint8_t *y, const uint8_t *uv, uint8_t *dst,
+			 unsigned int width, unsigned int x = 0)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+
+	if constexpr (output == Output::R8) {
+		memcpy(dst + x, y + x, width - x);
+		return;
+	}
+
+	for (; x < width; x += 2) {
+		int u = uv[x];
+		int v = uv[x + 1];
+
+		storePixel<output>(dst + x * bpp, y[x], u, v);
+		if (x + 1 < width)
+			storePixel<output>(dst + (x + 1) * bpp, y[x + 1], u, v);
+	}
+}
+
+/* -----------------------------------------------------------------------------
+ * AVX2 kernels
+ */
+
+#if HAVE_AVX2_KERNELS
+
+/*
+ * Convert 16 pixels, from 16 luma values and 8 interleaved chroma pairs, all
+ * stored in 16-bit lanes, to XRGB8888. The pixels are returned in order in the
+ * two output registers.
+ */
+__attribute__((target("avx2")))
+inline void yuvToXrgbAvx2(__m256i y, __m256i uv, __m256i *out0, __m256i *out1)
+{
+	__m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)),
+					   _MM_SHUFFLE(2, 2, 0, 0));
+	__m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)),
+					   _MM_SHUFFLE(3, 3, 1, 1));
+
+	__m256i c = _mm256_sub_epi16(y, _mm256_set1_epi16(16));
+	c = _mm256_add_epi16(_mm256_mullo_epi16(c, _mm256_set1_epi16(74)),
+			     _mm256_set1_epi16(32));
+	__m256i d = _mm256_sub_epi16(u, _mm256_set1_epi16(128));
+	__m256i e = _mm256_sub_epi16(v, _mm256_set1_epi16(128));
+
+	__m256i b = _mm256_adds_epi16(c, _mm256_mullo_epi16(d, _mm256_set1_epi16(129)));
+	__m256i g = _mm256_subs_epi16(c, _mm256_mullo_epi16(d, _mm256_set1_epi16(25)));
+	g = _mm256_subs_epi16(g, _mm256_mullo_epi16(e, _mm256_set1_epi16(52)));
+	__m256i r = _mm256_adds_epi16(c, _mm256_mullo_epi16(e, _mm256_set1_epi16(102)));
+
+	b = _mm256_srai_epi16(b, 6);
+	g = _mm256_srai_epi16(g, 6);
+	r = _mm256_srai_epi16(r, 6);
+
+	/*
+	 * Pack to 8 bits, interleave the components in B, G, R, X order, and
+	 * reorder the 128-bit lanes, which AVX2 processes independently.
+	 */
+	const __m256i interleave = _mm256_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11,
+						    4, 12, 5, 13, 6, 14, 7, 15,
+						    0, 8, 1, 9, 2, 10, 3, 11,
+						    4, 12, 5, 13, 6, 14, 7, 15);
+
+	__m256i bg = _mm256_shuffle_epi8(_mm256_packus_epi16(b, g), interleave);
+	__m256i rx = _mm256_shuffle_epi8(_mm256_packus_epi16(r, _mm256_set1_epi16(0xff)),
+					 interleave);
+
+	__m256i lo = _mm256_unpacklo_epi16(bg, rx);
+	__m256i hi = _mm256_unpackhi_epi16(bg, rx);
+
+	*out0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+	*out1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+/* Store 16 XRGB8888 pixels as XRGB8888 or RGB888. */
+template<Output output>
+__attribute__((target("avx2")))
+inline void storeAvx2(uint8_t *dst, __m256i out0, __m256i out1)
+{
+	if constexpr (output == Output::XRGB8888) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), out0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), out1);
+		return;
+	}
+
+	/*
+	 * Drop the X component, leaving 12 valid bytes in each 128-bit lane.
+	 * The 16-byte stores overlap, and the last one writes 4 bytes past
+	 * the 48 bytes of output, which callers must account for.
+	 */
+	const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+						 12, 13, 14, -1, -1, -1, -1,
+						 0, 1, 2, 4, 5, 6, 8, 9, 10,
+						 12, 13, 14, -1, -1, -1, -1);
+
+	out0 = _mm256_shuffle_epi8(out0, compact);
+	out1 = _mm256_shuffle_epi8(out1, compact);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+			 _mm256_castsi256_si128(out0));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12),
+			 _mm256_extracti128_si256(out0, 1));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 24),
+			 _mm256_castsi256_si128(out1));
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 36),
+			 _mm256_extracti128_si256(out1, 1));
+}
+
+/*
+ * Number of pixels that must remain after a block of 16 before the block can
+ * be processed with SIMD stores, to keep the RGB888 overlapping store within
+ * the row.
+ */
+template<Output output>
+constexpr unsigned int simdMargin()
+{
+	return output == Output::RGB888 ? 2 : 0;
+}
+
+template<Output output>
+__attribute__((target("avx2")))
+void packedRowAvx2(const uint8_t *src, uint8_t *dst, unsigned int width)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+	unsigned int x = 0;
+
+	if constexpr (output == Output::R8) {
+		const __m256i mask = _mm256_set1_epi16(0x00ff);
+
+		for (; x + 32 <= width; x += 32) {
+			const __m256i *in = reinterpret_cast<const __m256i *>(src + x * 2);
+			__m256i y0 = _mm256_and_si256(_mm256_loadu_si256(in), mask);
+			__m256i y1 = _mm256_and_si256(_mm256_loadu_si256(in + 1), mask);
+			__m256i y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1),
+							     _MM_SHUFFLE(3, 1, 2, 0));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), y);
+		}
+	} else {
+		for (; x + 16 + simdMargin<output>() <= width; x += 16) {
+			__m256i yuyv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2));
+			__m256i y = _mm256_and_si256(yuyv, _mm256_set1_epi16(0x00ff));
+			__m256i uv = _mm256_srli_epi16(yuyv, 8);
+			__m256i out0, out1;
+
+			yuvToXrgbAvx2(y, uv, &out0, &out1);
+			storeAvx2<output>(dst + x * bpp, out0, out1);
+		}
+	}
+
+	packedRowScalar<output>(src, dst, width, x);
+}
+
+template<Output output>
+__attribute__((target("avx2")))
+void semiPlanarRowAvx2(const uint8_t *y, const uint8_t *uv, uint8_t *dst,
+		       unsigned int width)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+	unsigned int x = 0;
+
+	if constexpr (output != Output::R8) {
+		for (; x + 16 + simdMargin<output>() <= width; x += 16) {
+			__m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+			__m128i chroma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + x));
+			__m256i out0, out1;
+
+			yuvToXrgbAvx2(_mm256_cvtepu8_epi16(luma),
+				      _mm256_cvtepu8_epi16(chroma), &out0, &out1);
+			storeAvx2<output>(dst + x * bpp, out0, out1);
+		}
+	}
+
+	semiPlanarRowScalar<output>(y, uv, dst, width, x);
+}
+
+#endif /* HAVE_AVX2_KERNELS */
+
+/* -----------------------------------------------------------------------------
+ * NEON kernels
+ */
+
+#if HAVE_NEON_KERNELS
+
+inline int16x8_t widen(uint8x8_t value)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(value));
+}
+
+inline void yuvToRgbNeon(int16x8_t y, int16x8_t u, int16x8_t v,
+			 uint8x8_t *b, uint8x8_t *g, uint8x8_t *r)
+{
+	int16x8_t c = vmulq_n_s16(vsubq_s16(y, vdupq_n_s16(16)), 74);
+	c = vaddq_s16(c, vdupq_n_s16(32));
+	int16x8_t d = vsubq_s16(u, vdupq_n_s16(128));
+	int16x8_t e = vsubq_s16(v, vdupq_n_s16(128));
+
+	int16x8_t bs = vqaddq_s16(c, vmulq_n_s16(d, 129));
+	int16x8_t gs = vqsubq_s16(vqsubq_s16(c, vmulq_n_s16(d, 25)),
+				  vmulq_n_s16(e, 52));
+	int16x8_t rs = vqaddq_s16(c, vmulq_n_s16(e, 102));
+
+	*b = vqmovun_s16(vshrq_n_s16(bs, 6));
+	*g = vqmovun_s16(vshrq_n_s16(gs, 6));
+	*r = vqmovun_s16(vshrq_n_s16(rs, 6));
+}
+
+/* Convert 16 pixels from 16 luma values and 8 interleaved chroma pairs. */
+template<Output output>
+inline void convertNeon(uint8x16_t y, uint8x16_t uv, uint8_t *dst)
+{
+	/* Deinterleave the chroma pairs, and duplicate each value. */
+	uint8x16x2_t chroma = vuzpq_u8(uv, uv);
+	uint8x16_t u = vzipq_u8(chroma.val[0], chroma.val[0]).val[0];
+	uint8x16_t v = vzipq_u8(chroma.val[1], chroma.val[1]).val[0];
+
+	uint8x8_t blo, glo, rlo, bhi, ghi, rhi;
+
+	yuvToRgbNeon(widen(vget_low_u8(y)), widen(vget_low_u8(u)),
+		     widen(vget_low_u8(v)), &blo, &glo, &rlo);
+	yuvToRgbNeon(widen(vget_high_u8(y)), widen(vget_high_u8(u)),
+		     widen(vget_high_u8(v)), &bhi, &ghi, &rhi);
+
+	if constexpr (output == Output::XRGB8888) {
+		uint8x16x4_t pixels;
+		pixels.val[0] = vcombine_u8(blo, bhi);
+		pixels.val[1] = vcombine_u8(glo, ghi);
+		pixels.val[2] = vcombine_u8(rlo, rhi);
+		pixels.val[3] = vdupq_n_u8(0xff);
+		vst4q_u8(dst, pixels);
+	} else {
+		uint8x16x3_t pixels;
+		pixels.val[0] = vcombine_u8(blo, bhi);
+		pixels.val[1] = vcombine_u8(glo, ghi);
+		pixels.val[2] = vcombine_u8(rlo, rhi);
+		vst3q_u8(dst, pixels);
+	}
+}
+
+template<Output output>
+void packedRowNeon(const uint8_t *src, uint8_t *dst, unsigned int width)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+	unsigned int x = 0;
+
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x2_t yuyv = vld2q_u8(src + x * 2);
+
+		if constexpr (output == Output::R8)
+			vst1q_u8(dst + x, yuyv.val[0]);
+		else
+			convertNeon<output>(yuyv.val[0], yuyv.val[1], dst + x * bpp);
+	}
+
+	packedRowScalar<output>(src, dst, width, x);
+}
+
+template<Output output>
+void semiPlanarRowNeon(const uint8_t *y, const uint8_t *uv, uint8_t *dst,
+		       unsigned int width)
+{
+	constexpr unsigned int bpp = bytesPerPixel<output>();
+	unsigned int x = 0;
+
+	if constexpr (output != Output::R8) {
+		for (; x + 16 <= width; x += 16)
+			convertNeon<output>(vld1q_u8(y + x), vld1q_u8(uv + x),
+					    dst + x * bpp);
+	}
+
+	semiPlanarRowScalar<output>(y, uv, dst, width, x);
+}
+
+#endif /* HAVE_NEON_KERNELS */
+
+/* -----------------------------------------------------------------------------
+ * Runtime dispatch
+ */
+
+template<Output output>
+void packedRow(const uint8_t *src, uint8_t *dst, unsigned int width)
+{
+	packedRowScalar<output>(src, dst, width);
+}
+
+template<Output output>
+void semiPlanarRow(const uint8_t *y, const uint8_t *uv, uint8_t *dst,
+		   unsigned int width)
+{
+	semiPlanarRowScalar<output>(y, uv, dst, width);
+}
+
+struct Kernels {
+	const char *name;
+	void (*packed[3])(const uint8_t *, uint8_t *, unsigned int);
+	void (*semiPlanar[3])(const uint8_t *, const uint8_t *, uint8_t *, unsigned int);
+};
+
+const Kernels scalarKernels = {
+	"scalar",
+	{ packedRow<Output::RGB888>, packedRow<Output::XRGB8888>, packedRow<Output::R8> },
+	{ semiPlanarRow<Output::RGB888>, semiPlanarRow<Output::XRGB8888>, semiPlanarRow<Output::R8> },
+};
+
+#if HAVE_AVX2_KERNELS
+const Kernels avx2Kernels = {
+	"avx2",
+	{ packedRowAvx2<Output::RGB888>, packedRowAvx2<Output::XRGB8888>, packedRowAvx2<Output::R8> },
+	{ semiPlanarRowAvx2<Output::RGB888>, semiPlanarRowAvx2<Output::XRGB8888>, semiPlanarRowAvx2<Output::R8> },
+};
+#endif
+
+#if HAVE_NEON_KERNELS
+const Kernels neonKernels = {
+	"neon",
+	{ packedRowNeon<Output::RGB888>, packedRowNeon<Output::XRGB8888>, packedRowNeon<Output::R8> },
+	{ semiPlanarRowNeon<Output::RGB888>, semiPlanarRowNeon<Output::XRGB8888>, semiPlanarRowNeon<Output::R8> },
+};
+#endif
+
+const Kernels &selectKernels()
+{
+#if HAVE_AVX2_KERNELS
+	if (__builtin_cpu_supports("avx2"))
+		return avx2Kernels;
+#endif
+
+#if HAVE_NEON_KERNELS
+	return neonKernels;
+#endif
+
+	return scalarKernels;
+}
+
+} /* namespace */
+
+std::unique_ptr<FormatConverter> FormatConverter::create(const PixelFormat &input,
+							 const PixelFormat &output,
+							 const Size &size,
+							 unsigned int stride)
+{
+	if (input != formats::YUYV && input != formats::NV12)
+		return nullptr;
+
+	unsigned int index;
+	unsigned int bpp;
+
+	if (output == formats::RGB888) {
+		index = static_cast<unsigned int>(Output::RGB888);
+		bpp = 3;
+	} else if (output == formats::XRGB8888) {
+		index = static_cast<unsigned int>(Output::XRGB8888);
+		bpp = 4;
+	} else if (output == formats::R8) {
+		index = static_cast<unsigned int>(Output::R8);
+		bpp = 1;
+	} else {
+		return nullptr;
+	}
+
+	std::unique_ptr<FormatConverter> converter{ new FormatConverter() };
+	const Kernels &kernels = selectKernels();
+
+	converter->input_ = input;
+	converter->output_ = output;
+	converter->size_ = size;
+	converter->stride_ = stride;
+	converter->outputStride_ = size.width * bpp;
+	converter->implementation_ = kernels.name;
+	converter->packedRow_ = kernels.packed[index];
+	converter->semiPlanarRow_ = kernels.semiPlanar[index];
+
+	return converter;
+}
+
+void FormatConverter::convert(const Image &input, Span<uint8_t> output) const
+{
+	const uint8_t *src = input.data(0).data();
+	uint8_t *dst = output.data();
+
+	if (input_ == formats::YUYV) {
+		for (unsigned int row = 0; row < size_.height; ++row) {
+			packedRow_(src, dst, size_.width);
+			src += stride_;
+			dst += outputStride_;
+		}
+
+		return;
+	}
+
+	/*
+	 * NV12 chroma is subsampled vertically, each chroma row is shared by
+	 * two luma rows. The chroma plane immediately follows the luma plane
+	 * when both are stored in the same FrameBuffer plane.
+	 */
+	const uint8_t *uv = input.numPlanes() > 1
+			  ? input.data(1).data()
+			  : src + stride_ * size_.height;
+
+	for (unsigned int row = 0; row < size_.height; ++row) {
+		semiPlanarRow_(src, uv + (row / 2) * stride_, dst, size_.width);
+		src += stride_;
+		dst += outputStride_;
+	}
+}
@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * format_converter.h - YUV to RGB and greyscale pixel format conversion
+ */
+#ifndef __SIMPLE_CAM_FORMAT_CONVERTER_H__
+#define __SIMPLE_CAM_FORMAT_CONVERTER_H__
+
+#include <memory>
+#include <stdint.h>
+
+#include <libcamera/base/span.h>
+
+#include <libcamera/geometry.h>
+#include <libcamera/pixel_format.h>
+
+#include "image.h"
+
+/*
+ * The FormatConverter converts images from the YUYV and NV12 formats commonly
+ * produced by cameras to RGB888, XRGB8888 or greyscale (R8). Conversion uses
+ * BT.601 limited range coefficients.
+ *
+ * Rows are converted with AVX2 or NEON kernels when supported by the CPU,
+ * selected at runtime, and otherwise with scalar kernels. All kernels produce
+ * identical results.
+ */
+class FormatConverter
+{
+public:
+	static std::unique_ptr<FormatConverter> create(const libcamera::PixelFormat &input,
+						       const libcamera::PixelFormat &output,
+						       const libcamera::Size &size,
+						       unsigned int stride);
+
+	const libcamera::PixelFormat &outputFormat() const { return output_; }
+	unsigned int outputStride() const { return outputStride_; }
+	size_t outputSize() const { return outputStride_ * size_.height; }
+
+	/* Name of the kernels implementation, for informative purposes. */
+	const char *implementation() const { return implementation_; }
+
+	void convert(const Image &input, libcamera::Span<uint8_t> output) const;
+
+private:
+	using PackedRowFunc = void (*)(const uint8_t *src, uint8_t *dst,
+				       unsigned int width);
+	using SemiPlanarRowFunc = void (*)(const uint8_t *y, const uint8_t *uv,
+					   uint8_t *dst, unsigned int width);
+
+	FormatConverter() = default;
+
+	libcamera::PixelFormat input_;
+	libcamera::PixelFormat output_;
+	libcamera::Size size_;
+	unsigned int stride_;
+	unsigned int outputStride_;
+
+	const char *implementation_;
+	PackedRowFunc packedRow_;
+	SemiPlanarRowFunc semiPlanarRow_;
+};
+
+#endif /* __SIMPLE_CAM_FORMAT_CONVERTER_H__ */
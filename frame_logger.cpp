@@ -0,0 +1,222 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_logger.cpp - Asynchronous per-frame binary logger
+ */
+
+#include "frame_logger.h"
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string.h>
+#include <unistd.h>
+
+#include <libcamera/control_ids.h>
+
+using namespace libcamera;
+
+namespace {
+
+/*
+ * Binary log files start with a header identifying the file format, followed
+ * by raw FrameRecord structures in native byte order.
+ */
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+};
+
+constexpr char kMagic[4] = { 'S', 'C', 'F', 'L' };
+constexpr uint32_t kVersion = 1;
+
+/* How often the writer thread drains the queue. */
+constexpr std::chrono::milliseconds kFlushInterval{ 10 };
+
+} /* namespace */
+
+/*
+ * Frames are logged from the capture hot path, so log() only copies the
+ * record to a lock-free queue. A background thread drains the queue, and
+ * either writes the records as-is to a binary file, or formats them as text
+ * on the standard output. The writer polls the queue periodically instead of
+ * being woken up, so that logging a frame never involves a system call.
+ */
+FrameLogger::FrameLogger(size_t capacity)
+	: queue_(capacity), dropped_(0), running_(false), fd_(-1)
+{
+}
+
+FrameLogger::~FrameLogger()
+{
+	stop();
+}
+
+int FrameLogger::start(const std::string &filename)
+{
+	if (!filename.empty()) {
+		fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			   0644);
+		if (fd_ < 0) {
+			int ret = -errno;
+			std::cerr << "Failed to open log file " << filename
+				  << ": " << strerror(-ret) << std::endl;
+			return ret;
+		}
+
+		FileHeader header;
+		memcpy(header.magic, kMagic, sizeof(header.magic));
+		header.version = kVersion;
+		header.recordSize = sizeof(FrameRecord);
+
+		if (write(fd_, &header, sizeof(header)) != sizeof(header)) {
+			std::cerr << "Failed to write log file header" << std::endl;
+			close(fd_);
+			fd_ = -1;
+			return -EIO;
+		}
+	}
+
+	running_.store(true, std::memory_order_release);
+	thread_ = std::thread(&FrameLogger::run, this);
+
+	return 0;
+}
+
+void FrameLogger::stop()
+{
+	if (!thread_.joinable())
+		return;
+
+	running_.store(false, std::memory_order_release);
+	thread_.join();
+
+	uint64_t dropped = dropped_.exchange(0);
+	if (dropped)
+		std::cerr << "Frame logger dropped " << dropped << " records"
+			  << std::endl;
+
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+}
+
+/*
+ * Log a frame record. This can be called from any thread, and never blocks.
+ * When the queue is full the record is dropped and accounted for.
+ */
+void FrameLogger::log(FrameRecord &&record)
+{
+	if (!queue_.push(std::move(record)))
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameLogger::run()
+{
+	while (running_.load(std::memory_order_acquire)) {
+		flush();
+		std::this_thread::sleep_for(kFlushInterval);
+	}
+
+	flush();
+}
+
+void FrameLogger::flush()
+{
+	FrameRecord records[32];
+	unsigned int count = 0;
+
+	for (;;) {
+		bool more = queue_.pop(&records[count]);
+		if (more)
+			count++;
+
+		if (count == std::size(records) || (!more && count)) {
+			if (fd_ >= 0) {
+				ssize_t size = sizeof(records[0]) * count;
+				if (write(fd_, records, size) != size)
+					std::cerr << "Failed to write log records"
+						  << std::endl;
+			} else {
+				for (unsigned int i = 0; i < count; ++i)
+					format(records[i], std::cout);
+			}
+
+			count = 0;
+		}
+
+		if (!more)
+			break;
+	}
+}
+
+void FrameLogger::format(const FrameRecord &record, std::ostream &out)
+{
+	out << "cam" << static_cast<unsigned int>(record.camera)
+	    << " stream" << static_cast<unsigned int>(record.stream)
+	    << " seq: " << std::setw(6) << std::setfill('0') << record.sequence
+	    << " timestamp: " << record.timestamp
+	    << " bytesused: ";
+
+	for (unsigned int i = 0; i < record.numPlanes; ++i) {
+		if (i)
+			out << "/";
+		out << record.bytesused[i];
+	}
+
+	out << std::endl;
+
+	for (unsigned int i = 0; i < record.numControls; ++i) {
+		const FrameRecord::Control &ctrl = record.controls[i];
+		auto iter = controls::controls.find(ctrl.id);
+
+		out << "\t";
+		if (iter != controls::controls.end())
+			out << iter->second->name();
+		else
+			out << "0x" << std::hex << ctrl.id << std::dec;
+
+		out << " = ";
+		if (ctrl.type == FrameRecord::Float)
+			out << ctrl.real;
+		else
+			out << ctrl.integer;
+		out << std::endl;
+	}
+}
+
+/* Decode a binary log file, and print its records as text. */
+int FrameLogger::dump(const std::string &filename, std::ostream &out)
+{
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to open log file " << filename << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	FileHeader header;
+	if (read(fd, &header, sizeof(header)) != sizeof(header) ||
+	    memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+	    header.version != kVersion ||
+	    header.recordSize != sizeof(FrameRecord)) {
+		std::cerr << "Invalid log file " << filename << std::endl;
+		close(fd);
+		return -EINVAL;
+	}
+
+	FrameRecord record;
+	while (read(fd, &record, sizeof(record)) == sizeof(record))
+		format(record, out);
+
+	close(fd);
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_logger.h - Asynchronous per-frame binary logger
+ */
+#ifndef __SIMPLE_CAM_FRAME_LOGGER_H__
+#define __SIMPLE_CAM_FRAME_LOGGER_H__
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+#include "mpsc_queue.h"
+
+/*
+ * A FrameRecord holds all the information logged for one completed buffer.
+ * It is a fixed size plain structure, written as-is to binary log files, so
+ * that logging a frame never allocates memory or formats text.
+ */
+struct FrameRecord {
+	static constexpr unsigned int kMaxPlanes = 4;
+	static constexpr unsigned int kMaxControls = 8;
+
+	enum ValueType : uint8_t {
+		Integer,
+		Float,
+	};
+
+	struct Control {
+		uint32_t id;
+		uint8_t type;
+		union {
+			int64_t integer;
+			double real;
+		};
+	};
+
+	uint8_t camera;
+	uint8_t stream;
+	uint8_t numPlanes;
+	uint8_t numControls;
+	uint32_t sequence;
+	uint64_t timestamp;
+	uint32_t bytesused[kMaxPlanes];
+	Control controls[kMaxControls];
+};
+
+class FrameLogger
+{
+public:
+	FrameLogger(size_t capacity = 1024);
+	~FrameLogger();
+
+	int start(const std::string &filename);
+	void stop();
+
+	void log(FrameRecord &&record);
+
+	static int dump(const std::string &filename, std::ostream &out);
+	static void format(const FrameRecord &record, std::ostream &out);
+
+private:
+	void run();
+	void flush();
+
+	MpscQueue<FrameRecord> queue_;
+	std::atomic<uint64_t> dropped_;
+
+	std::thread thread_;
+	std::atomic<bool> running_;
+	int fd_;
+};
+
+#endif /* __SIMPLE_CAM_FRAME_LOGGER_H__ */
@@ -0,0 +1,533 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_pipeline.cpp - Dispatch of frames to the consumers
+ */
+
+#include "frame_pipeline.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <thread>
+
+#include "allocation_counter.h"
+#include "converter_sink.h"
+#include "disk_writer.h"
+#include "encoder_sink.h"
+#include "frame_logger.h"
+#include "network_sink.h"
+#include "numa.h"
+#include "recording.h"
+#include "thread_pool.h"
+
+using namespace libcamera;
+
+FramePipeline::FramePipeline(const std::string &name, const Options &options,
+			     EventLoop *loop, FrameLogger *logger,
+			     ThreadPool *pool, Metrics *metrics, Source *source)
+	: name_(name), converts_(options.converts), saveDir_(options.saveDir),
+	  recordDir_(options.recordDir), sendAddress_(options.sendAddress),
+	  encodeDir_(options.encodeDir), encodeCodec_(options.encodeCodec),
+	  encoderDevice_(options.encoderDevice), recordSlots_(options.recordSlots),
+	  loop_(loop), logger_(logger), pool_(pool), source_(source),
+	  numaNode_(-1), processing_(0), dropPolicy_(options),
+	  queuedRequests_(0), warmup_(options.warmup),
+	  countAllocations_(options.countAllocations), allocationWarmup_(0),
+	  counting_(false), processedRequests_(0), countedRequests_(0),
+	  localFrames_(0), remoteFrames_(0), metrics_(metrics)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+	sinks_.clear();
+}
+
+/*
+ * Consumers are handed the frames of the given stream, or of all streams if
+ * the stream index is negative, in the order they are added.
+ */
+void FramePipeline::addSink(std::unique_ptr<FrameSink> sink, int stream)
+{
+	sinks_.emplace_back(stream, std::move(sink));
+}
+
+/*
+ * Size the per-stream state for the streams of the source and their buffers,
+ * and create the consumers that only need the stream configurations and
+ * buffers. Consumers that depend on the source are added by the source.
+ */
+int FramePipeline::configure(const std::vector<StreamConfig> &streams)
+{
+	size_t numFrames = 0;
+
+	/* At most one frame per buffer can be waiting to be reordered. */
+	reorder_.resize(streams.size());
+	for (unsigned int i = 0; i < streams.size(); ++i) {
+		reorder_[i].slots.resize(streams[i].buffers->size());
+		numFrames += streams[i].buffers->size();
+	}
+
+	heldFrames_.resize(streams.size());
+	stats_.resize(streams.size());
+	completedFrames_.reserve(numFrames);
+
+	if (metrics_)
+		registerMetrics();
+
+	return createSinks(streams, numFrames);
+}
+
+/*
+ * Register the live metrics of the pipeline. Rates are computed by the
+ * monitoring system from the frame and byte counters.
+ */
+void FramePipeline::registerMetrics()
+{
+	std::string camera = "camera=\"" + name_ + "\"";
+
+	streamMetrics_.resize(stats_.size());
+
+	for (unsigned int i = 0; i < stats_.size(); ++i) {
+		std::string labels = camera + ",stream=\"" + std::to_string(i) + "\"";
+		StreamMetrics &stream = streamMetrics_[i];
+
+		stream.frames = metrics_->counter("simplecam_frames_total", labels,
+						  "Frames captured");
+		stream.bytes = metrics_->counter("simplecam_bytes_total", labels,
+						 "Bytes captured");
+		stream.dropped = metrics_->counter("simplecam_dropped_frames_total", labels,
+						   "Frames dropped by the camera, from sequence gaps");
+		stream.captureLatency =
+			metrics_->latencyHistogram("simplecam_capture_latency_seconds", labels,
+						   "Time from the sensor timestamp to the request completion");
+		stream.dispatchLatency =
+			metrics_->latencyHistogram("simplecam_dispatch_latency_seconds", labels,
+						   "Time from the request completion to its processing");
+		stream.first = true;
+		stream.lastSequence = 0;
+	}
+
+	policyDrops_ = metrics_->counter("simplecam_policy_dropped_requests_total", camera,
+					 "Requests dropped by the drop policy");
+	workerFrames_ = metrics_->counter("simplecam_worker_frames_total", camera,
+					  "Frames processed by the worker threads");
+	backlog_ = metrics_->gauge("simplecam_waiting_requests", camera,
+				   "Completed requests waiting to be processed");
+}
+
+/*
+ * Consumers are set up from the format, size and stride of the stream they
+ * apply to.
+ */
+int FramePipeline::createSinks(const std::vector<StreamConfig> &streams,
+				size_t numFrames)
+{
+	for (const ConvertOptions &convert : converts_) {
+		if (convert.stream >= streams.size()) {
+			std::cerr << name_ << ": Can't convert stream"
+				  << convert.stream << ": no such stream" << std::endl;
+			return -EINVAL;
+		}
+
+		const StreamConfiguration &cfg = streams[convert.stream].config;
+		std::unique_ptr<FormatConverter> converter =
+			FormatConverter::create(cfg.pixelFormat, convert.format,
+						cfg.size, cfg.stride);
+		if (!converter) {
+			std::cerr << name_ << ": Can't convert stream"
+				  << convert.stream << " from "
+				  << cfg.pixelFormat.toString() << " to "
+				  << convert.format.toString() << std::endl;
+			return -EINVAL;
+		}
+
+		std::cout << name_ << ": Converting stream" << convert.stream
+			  << " to " << convert.format.toString() << " ("
+			  << converter->implementation() << ")" << std::endl;
+
+		addSink(std::make_unique<ConverterSink>(std::move(converter)),
+			convert.stream);
+	}
+
+	if (!saveDir_.empty()) {
+		for (unsigned int i = 0; i < streams.size(); ++i) {
+			std::string filename = saveDir_ + "/" + name_ + "-stream"
+					     + std::to_string(i) + ".frames";
+
+			addSink(std::make_unique<DiskWriter>(filename,
+							     streams[i].config.frameSize,
+							     streams[i].buffers->size()),
+				i);
+		}
+	}
+
+	if (!encodeDir_.empty()) {
+		const char *extension = encodeCodec_ == EncoderCodec::MJPEG
+				      ? ".mjpeg" : ".h264";
+
+		for (unsigned int i = 0; i < streams.size(); ++i) {
+			std::string filename = encodeDir_ + "/" + name_ + "-stream"
+					     + std::to_string(i) + extension;
+
+			addSink(std::make_unique<EncoderSink>(loop_, encoderDevice_,
+							      encodeCodec_, filename,
+							      streams[i].config,
+							      *streams[i].buffers),
+				i);
+		}
+	}
+
+	/* All streams are recorded to the same file, sized for the largest. */
+	if (!recordDir_.empty()) {
+		size_t slotSize = 0;
+		for (const StreamConfig &stream : streams)
+			slotSize = std::max<size_t>(slotSize, stream.config.frameSize);
+
+		addSink(std::make_unique<RecordingWriter>(recordDir_ + "/" + name_ + ".rec",
+							  slotSize, recordSlots_));
+	}
+
+	if (!sendAddress_.empty())
+		addSink(std::make_unique<NetworkSink>(loop_, sendAddress_, numFrames));
+
+	return 0;
+}
+
+/*
+ * Start the consumers. The first frames of each stream, by default the given
+ * number, are excluded from the statistics and from the allocation count.
+ */
+int FramePipeline::start(unsigned int warmup)
+{
+	if (warmup_ >= 0)
+		warmup = warmup_;
+
+	for (FrameStats &stats : stats_)
+		stats.reset(warmup);
+
+	allocationWarmup_ = warmup;
+	counting_.store(false, std::memory_order_relaxed);
+	processedRequests_ = 0;
+	countedRequests_ = 0;
+
+	/*
+	 * Frames of streams without consumers requiring capture order skip
+	 * the reorder stage, and are recycled as soon as they are processed.
+	 */
+	orderedSinks_.assign(stats_.size(), false);
+	for (unsigned int i = 0; i < stats_.size(); ++i) {
+		for (auto &[stream, sink] : sinks_) {
+			if ((stream < 0 || static_cast<unsigned int>(stream) == i) &&
+			    !sink->concurrent())
+				orderedSinks_[i] = true;
+		}
+
+		ReorderQueue &queue = reorder_[i];
+		std::fill(queue.slots.begin(), queue.slots.end(), nullptr);
+		queue.head = 0;
+		queue.tail = 0;
+	}
+
+	/* Only extract the metadata controls the consumers use. */
+	uint32_t controls = 0;
+	for (auto &[stream, sink] : sinks_)
+		controls |= sink->metadataControls();
+	metadataFilter_.select(controls);
+
+	for (auto &[stream, sink] : sinks_) {
+		int ret = sink->start();
+		if (ret < 0) {
+			std::cerr << name_ << ": Failed to start consumer" << std::endl;
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void FramePipeline::stop()
+{
+	/*
+	 * Wait for the worker threads to be done with the frames before
+	 * stopping the consumers.
+	 */
+	while (processing_.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	for (auto &[stream, sink] : sinks_)
+		sink->stop();
+}
+
+bool FramePipeline::failed() const
+{
+	for (const auto &[stream, sink] : sinks_) {
+		if (sink->failed())
+			return true;
+	}
+
+	return false;
+}
+
+/* Restart the statistics, leaving out the time the source was paused. */
+void FramePipeline::restartStats()
+{
+	for (FrameStats &stats : stats_)
+		stats.restart();
+	for (StreamMetrics &stream : streamMetrics_)
+		stream.first = true;
+}
+
+/*
+ * Account for a batch of frames completed by the source, from any thread, and
+ * queued to the event loop.
+ */
+void FramePipeline::queue()
+{
+	queuedRequests_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Processing a batch must not allocate memory. When checked, heap allocations
+ * are counted after the warmup, once the consumers have settled. Return
+ * whether the allocations are counted for the batch being processed.
+ */
+bool FramePipeline::countAllocations()
+{
+	if (countAllocations_ && !counting_.load(std::memory_order_relaxed)) {
+		if (++processedRequests_ > allocationWarmup_)
+			counting_.store(true, std::memory_order_relaxed);
+	}
+
+	bool counting = counting_.load(std::memory_order_relaxed);
+	if (counting)
+		countedRequests_++;
+
+	return counting;
+}
+
+/*
+ * Decide whether the consumers can take the batch, from the number of newer
+ * batches that have completed already, and the number of frames the
+ * consumers still hold.
+ */
+bool FramePipeline::admit()
+{
+	unsigned int waiting = queuedRequests_.fetch_sub(1, std::memory_order_relaxed) - 1;
+	unsigned int held = *std::max_element(heldFrames_.begin(), heldFrames_.end());
+	bool admitted = dropPolicy_.admit(waiting, held);
+
+	if (metrics_) {
+		backlog_.set(waiting);
+		if (!admitted)
+			policyDrops_.add();
+	}
+
+	return admitted;
+}
+
+/*
+ * Add a filled frame to the batch, processed at the given time, and account
+ * for it in the statistics and metrics.
+ */
+void FramePipeline::addFrame(Frame *frame, uint64_t now)
+{
+	const FrameMetadata &metadata = frame->metadata();
+	unsigned int index = frame->streamIndex();
+	uint64_t completed = frame->completed();
+
+	uint64_t bytes = 0;
+	for (const FrameMetadata::Plane &plane : metadata.planes())
+		bytes += plane.bytesused;
+
+	stats_[index].record(metadata.sequence, metadata.timestamp,
+			     completed, now, bytes);
+
+	if (metrics_) {
+		StreamMetrics &stream = streamMetrics_[index];
+
+		if (!stream.first && metadata.sequence > stream.lastSequence + 1)
+			stream.dropped.add(metadata.sequence - stream.lastSequence - 1);
+
+		stream.first = false;
+		stream.lastSequence = metadata.sequence;
+
+		stream.frames.add();
+		stream.bytes.add(bytes);
+		stream.captureLatency.record(completed - metadata.timestamp);
+		stream.dispatchLatency.record(now - completed);
+	}
+
+	/* Log some information about the buffer which has completed. */
+	if (logger_)
+		logger_->log(FrameRecord(frame->record()));
+
+	frame->acquire();
+	completedFrames_.push_back(frame);
+	heldFrames_[index]++;
+}
+
+/*
+ * The image data of a completed buffer is accessed through the spans of its
+ * mapped planes. The spans point directly to the dmabuf memory the buffer was
+ * captured to, there is no copy involved.
+ *
+ * This is where an application would process the image. The data is only
+ * valid until the buffer is queued back to the camera.
+ */
+static void processImage(const Stream *stream, const FrameMetadata &metadata,
+			 const Image &image)
+{
+	for (unsigned int i = 0; i < image.numPlanes(); ++i) {
+		Span<const uint8_t> data =
+			image.data(i).first(metadata.planes()[i].bytesused);
+
+		(void)data;
+	}
+}
+
+/* Hand the frames of the batch to the consumers, or drop them. */
+void FramePipeline::dispatch(bool admitted)
+{
+	for (Frame *frame : completedFrames_) {
+		/* Dropped frames are recycled right away. */
+		if (!admitted) {
+			if (frame->unref())
+				recycleFrame(frame);
+			continue;
+		}
+
+		if (pool_) {
+			submitFrame(frame);
+			continue;
+		}
+
+		/*
+		 * Image data can be accessed here, through the mapping
+		 * created when the buffer was allocated.
+		 */
+		accountNode(frame);
+		processImage(frame->stream(), frame->metadata(), frame->image());
+
+		for (auto &[stream, sink] : sinks_) {
+			if (stream < 0 || static_cast<unsigned int>(stream) == frame->streamIndex())
+				sink->processFrame(frame);
+		}
+
+		/*
+		 * Consumers that still need the frame have taken their own
+		 * reference, and will release it later.
+		 */
+		if (frame->unref())
+			recycleFrame(frame);
+	}
+
+	completedFrames_.clear();
+}
+
+void FramePipeline::submitFrame(Frame *frame)
+{
+	uint64_t ticket = 0;
+	if (orderedSinks_[frame->streamIndex()])
+		ticket = reorder_[frame->streamIndex()].tail++;
+
+	processing_.fetch_add(1, std::memory_order_relaxed);
+
+	pool_->submit([this, frame, ticket]() {
+		processFrameAsync(frame, ticket);
+	}, numaNode_);
+}
+
+/*
+ * Process a frame in a worker thread, and hand it to the reorder stage, or
+ * release it right away if no consumer requires the capture order.
+ */
+void FramePipeline::processFrameAsync(Frame *frame, uint64_t ticket)
+{
+	AllocationScope allocations(counting_.load(std::memory_order_relaxed));
+
+	accountNode(frame);
+	processImage(frame->stream(), frame->metadata(), frame->image());
+	runSinks(frame, true);
+
+	workerFrames_.add();
+
+	if (orderedSinks_[frame->streamIndex()])
+		loop_->callLater([this, frame, ticket]() { emitFrame(frame, ticket); });
+	else
+		frame->release();
+
+	processing_.fetch_sub(1, std::memory_order_release);
+}
+
+/*
+ * Store a processed frame in its reorder slot, and emit all the frames that
+ * are now in capture order to the ordered consumers.
+ */
+void FramePipeline::emitFrame(Frame *frame, uint64_t ticket)
+{
+	AllocationScope allocations(counting_.load(std::memory_order_relaxed));
+
+	ReorderQueue &queue = reorder_[frame->streamIndex()];
+	queue.slots[ticket % queue.slots.size()] = frame;
+
+	for (;;) {
+		Frame *&slot = queue.slots[queue.head % queue.slots.size()];
+		Frame *next = slot;
+		if (!next)
+			break;
+
+		slot = nullptr;
+		queue.head++;
+
+		runSinks(next, false);
+
+		if (next->unref())
+			recycleFrame(next);
+	}
+}
+
+void FramePipeline::runSinks(Frame *frame, bool concurrent)
+{
+	for (auto &[stream, sink] : sinks_) {
+		if (sink->concurrent() != concurrent)
+			continue;
+
+		if (stream < 0 || static_cast<unsigned int>(stream) == frame->streamIndex())
+			sink->processFrame(frame);
+	}
+}
+
+/*
+ * Account for a frame processed in the calling thread, as local if the thread
+ * runs on the NUMA node of the buffer, or remote otherwise.
+ */
+void FramePipeline::accountNode(const Frame *frame)
+{
+	if (frame->memoryNode() < 0)
+		return;
+
+	if (numaCurrentNode() == frame->memoryNode())
+		localFrames_.fetch_add(1, std::memory_order_relaxed);
+	else
+		remoteFrames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+ * Called when the last consumer releases a frame, from any thread. The frame
+ * is recycled in the event loop thread.
+ */
+void FramePipeline::frameReleased(Frame *frame)
+{
+	loop_->callLater([this, frame]() { recycleFrame(frame); });
+}
+
+void FramePipeline::recycleFrame(Frame *frame)
+{
+	AllocationScope allocations(counting_.load(std::memory_order_relaxed));
+
+	heldFrames_[frame->streamIndex()]--;
+	source_->recycleFrame(frame);
+}
@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_pipeline.h - Dispatch of frames to the consumers
+ */
+#ifndef __SIMPLE_CAM_FRAME_PIPELINE_H__
+#define __SIMPLE_CAM_FRAME_PIPELINE_H__
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/stream.h>
+
+#include "drop_policy.h"
+#include "event_loop.h"
+#include "frame_sink.h"
+#include "frame_stats.h"
+#include "metadata_filter.h"
+#include "metrics.h"
+#include "options.h"
+
+class FrameLogger;
+class ThreadPool;
+
+/*
+ * The FramePipeline hands the frames of a source to the consumers. The
+ * CameraSession feeds it with the frames of the completed requests, and the
+ * ReplaySession with the frames of a trace, so that frames are replayed
+ * through exactly the same path as they are captured.
+ *
+ * The source hands the frames completed together, such as the buffers of a
+ * request, as a batch :
+ *
+ * - queue() is called when the batch completes, from any thread, before the
+ *   batch is handed to the event loop,
+ * - countAllocations() and admit() are then called from the event loop, to
+ *   count the heap allocations and apply the drop policy,
+ * - each frame is filled, and added with addFrame(), which accounts for it in
+ *   the statistics and metrics, and logs it,
+ * - dispatch() finally hands the frames to the consumers, directly, or
+ *   through the worker threads and the reorder stage.
+ *
+ * The pipeline owns the frames while the consumers hold them. Once the last
+ * consumer releases a frame, it is given back to the source with
+ * Source::recycleFrame(), in the event loop thread.
+ */
+class FramePipeline : public Frame::Owner
+{
+public:
+	class Source
+	{
+	public:
+		virtual ~Source() = default;
+		virtual void recycleFrame(Frame *frame) = 0;
+	};
+
+	/* A stream of the source, with the buffers its frames are stored in. */
+	struct StreamConfig {
+		libcamera::StreamConfiguration config;
+		const std::vector<std::unique_ptr<libcamera::FrameBuffer>> *buffers;
+	};
+
+	FramePipeline(const std::string &name, const Options &options,
+		      EventLoop *loop, FrameLogger *logger, ThreadPool *pool,
+		      Metrics *metrics, Source *source);
+	~FramePipeline();
+
+	void addSink(std::unique_ptr<FrameSink> sink, int stream = -1);
+
+	int configure(const std::vector<StreamConfig> &streams);
+	void setNumaNode(int node) { numaNode_ = node; }
+
+	int start(unsigned int warmup);
+	void stop();
+	void restartStats();
+
+	/* True if a consumer failed while running, once stopped. */
+	bool failed() const;
+
+	void queue();
+	bool countAllocations();
+	bool admit();
+	void addFrame(Frame *frame, uint64_t now);
+	void dispatch(bool admitted);
+
+	void frameReleased(Frame *frame) override;
+
+	const CaptureMetadataFilter &metadataFilter() const { return metadataFilter_; }
+
+	const FrameStats &stats(unsigned int index) const { return stats_[index]; }
+	uint64_t dropped() const { return dropPolicy_.dropped(); }
+
+	/* Number of batches processed while counting heap allocations. */
+	uint64_t countedRequests() const { return countedRequests_; }
+
+	/* Frames processed on the NUMA node of their buffer, or on another. */
+	uint64_t localFrames() const { return localFrames_.load(std::memory_order_relaxed); }
+	uint64_t remoteFrames() const { return remoteFrames_.load(std::memory_order_relaxed); }
+
+private:
+	int createSinks(const std::vector<StreamConfig> &streams, size_t numFrames);
+	void registerMetrics();
+
+	void submitFrame(Frame *frame);
+	void processFrameAsync(Frame *frame, uint64_t ticket);
+	void emitFrame(Frame *frame, uint64_t ticket);
+	void runSinks(Frame *frame, bool concurrent);
+	void accountNode(const Frame *frame);
+	void recycleFrame(Frame *frame);
+
+	std::string name_;
+	std::vector<ConvertOptions> converts_;
+	std::string saveDir_;
+	std::string recordDir_;
+	std::string sendAddress_;
+	std::string encodeDir_;
+	EncoderCodec encodeCodec_;
+	std::string encoderDevice_;
+	unsigned int recordSlots_;
+
+	EventLoop *loop_;
+	FrameLogger *logger_;
+	ThreadPool *pool_;
+	Source *source_;
+	int numaNode_;
+
+	/* Consumers, and the index of the stream they consume, or -1 for all. */
+	std::vector<std::pair<int, std::unique_ptr<FrameSink>>> sinks_;
+
+	/* Restricted to the metadata controls used by the consumers. */
+	CaptureMetadataFilter metadataFilter_;
+
+	/* Frames of the batch being processed. */
+	std::vector<Frame *> completedFrames_;
+
+	/*
+	 * When a thread pool is used, frames are processed by the worker
+	 * threads, and then handed to the consumers that are not concurrent
+	 * in capture order, per stream. Frames are tagged with a ticket when
+	 * they are submitted, and wait in the reorder slot of their ticket
+	 * until all the previous frames of the stream have been emitted.
+	 */
+	struct ReorderQueue {
+		std::vector<Frame *> slots;
+		uint64_t head;
+		uint64_t tail;
+	};
+
+	std::vector<ReorderQueue> reorder_;
+	std::vector<bool> orderedSinks_;
+	std::atomic<unsigned int> processing_;
+
+	/*
+	 * Batches dropped when the consumers are overloaded, based on the
+	 * number of batches completed but not processed yet, and the number
+	 * of frames held by the consumers, per stream.
+	 */
+	DropPolicy dropPolicy_;
+	std::atomic<unsigned int> queuedRequests_;
+	std::vector<unsigned int> heldFrames_;
+
+	/*
+	 * Steady-state statistics, per stream. The first frames, captured
+	 * while the camera pipeline fills up, are not accounted for.
+	 */
+	std::vector<FrameStats> stats_;
+	int warmup_;
+
+	/*
+	 * Heap allocations are counted once the warmup batches have been
+	 * processed, in all the threads processing the frames.
+	 */
+	bool countAllocations_;
+	unsigned int allocationWarmup_;
+	std::atomic<bool> counting_;
+	uint64_t processedRequests_;
+	uint64_t countedRequests_;
+
+	std::atomic<uint64_t> localFrames_;
+	std::atomic<uint64_t> remoteFrames_;
+
+	/*
+	 * Live metrics, if enabled. They are updated along with the
+	 * statistics, and scraped from another thread.
+	 */
+	struct StreamMetrics {
+		Metrics::Counter frames;
+		Metrics::Counter bytes;
+		Metrics::Counter dropped;
+		Metrics::LatencyHistogram captureLatency;
+		Metrics::LatencyHistogram dispatchLatency;
+		bool first;
+		unsigned int lastSequence;
+	};
+
+	Metrics *metrics_;
+	std::vector<StreamMetrics> streamMetrics_;
+	Metrics::Counter policyDrops_;
+	Metrics::Counter workerFrames_;
+	Metrics::Gauge backlog_;
+};
+
+#endif /* __SIMPLE_CAM_FRAME_PIPELINE_H__ */
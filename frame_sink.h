@@ -0,0 +1,163 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_sink.h - Consumers of captured frames
+ */
+#ifndef __SIMPLE_CAM_FRAME_SINK_H__
+#define __SIMPLE_CAM_FRAME_SINK_H__
+
+#include <atomic>
+#include <stdint.h>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+#include "frame_logger.h"
+#include "image.h"
+#include "metadata_filter.h"
+
+/*
+ * A Frame is a captured buffer handed to consumers. Frames are created once
+ * per buffer when the buffers are allocated, and reused for every capture.
+ *
+ * The buffer is owned by the consumers for as long as the frame holds
+ * references. Consumers that need to keep the frame after
+ * FrameSink::processFrame() returns take a reference with acquire(), and drop
+ * it with release() when done, from any thread. The frame owner is notified
+ * when the last reference is dropped, and only then gives the buffer back to
+ * the camera.
+ */
+class Frame
+{
+public:
+	class Owner
+	{
+	public:
+		virtual ~Owner() = default;
+		virtual void frameReleased(Frame *frame) = 0;
+	};
+
+	Frame(Owner *owner, unsigned int streamIndex,
+	      const libcamera::Stream *stream, libcamera::FrameBuffer *buffer,
+	      const Image *image)
+		: owner_(owner), streamIndex_(streamIndex), stream_(stream),
+		  buffer_(buffer), image_(image), metadata_(&buffer->metadata()),
+		  request_(nullptr), record_{}, completed_(0), memoryNode_(-1),
+		  refs_(0)
+	{
+	}
+
+	unsigned int streamIndex() const { return streamIndex_; }
+	const libcamera::Stream *stream() const { return stream_; }
+	libcamera::FrameBuffer *buffer() const { return buffer_; }
+	const Image &image() const { return *image_; }
+	const libcamera::FrameMetadata &metadata() const { return *metadata_; }
+
+	/*
+	 * Frames that are not captured by a camera, such as replayed frames,
+	 * carry their own metadata instead of the one of their buffer.
+	 */
+	void setMetadata(const libcamera::FrameMetadata *metadata) { metadata_ = metadata; }
+
+	/*
+	 * Compact copy of the buffer and request metadata, which remains
+	 * available after the request has been requeued.
+	 */
+	const FrameRecord &record() const { return record_; }
+	FrameRecord &record() { return record_; }
+
+	/* Time the request completed at, in nanoseconds (CLOCK_MONOTONIC). */
+	uint64_t completed() const { return completed_; }
+	void setCompleted(uint64_t completed) { completed_ = completed; }
+
+	/*
+	 * Typed values of the request metadata controls used by the consumers,
+	 * as declared by FrameSink::metadataControls().
+	 */
+	const CaptureMetadata &captureMetadata() const { return captureMetadata_; }
+	CaptureMetadata &captureMetadata() { return captureMetadata_; }
+
+	/*
+	 * The request the buffer was captured with, if the buffer is still
+	 * part of it, or nullptr if the request has already been requeued.
+	 */
+	libcamera::Request *request() const { return request_; }
+	void setRequest(libcamera::Request *request) { request_ = request; }
+
+	/* NUMA node of the buffer memory, or -1 if unknown. */
+	int memoryNode() const { return memoryNode_; }
+	void setMemoryNode(int node) { memoryNode_ = node; }
+
+	void acquire()
+	{
+		refs_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release()
+	{
+		if (unref())
+			owner_->frameReleased(this);
+	}
+
+	/*
+	 * Drop a reference without notifying the owner, and return true if it
+	 * was the last one. This is used by the owner itself.
+	 */
+	bool unref()
+	{
+		return refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+	}
+
+private:
+	Owner *owner_;
+	unsigned int streamIndex_;
+	const libcamera::Stream *stream_;
+	libcamera::FrameBuffer *buffer_;
+	const Image *image_;
+	const libcamera::FrameMetadata *metadata_;
+	libcamera::Request *request_;
+	FrameRecord record_;
+	uint64_t completed_;
+	CaptureMetadata captureMetadata_;
+	int memoryNode_;
+	std::atomic<unsigned int> refs_;
+};
+
+class FrameSink
+{
+public:
+	virtual ~FrameSink() = default;
+
+	virtual int start() { return 0; }
+	virtual void stop() {}
+
+	/*
+	 * Called for every captured frame. Frames are processed in capture
+	 * order from the session thread, unless the sink is concurrent.
+	 */
+	virtual void processFrame(Frame *frame) = 0;
+
+	/*
+	 * Concurrent sinks are called from the worker threads when a thread
+	 * pool is used, for several frames at the same time, and in no
+	 * particular order.
+	 */
+	virtual bool concurrent() const { return false; }
+
+	/*
+	 * Controls of the capture metadata the sink reads from the frames, as
+	 * a CaptureMetadataFilter::mask(). Only the controls used by at least
+	 * one sink are extracted from the request metadata.
+	 */
+	virtual uint32_t metadataControls() const { return 0; }
+
+	/*
+	 * Sinks that can fail while running, when writing the frames or when
+	 * the connection to a peer is lost, report it once stopped.
+	 */
+	virtual bool failed() const { return false; }
+};
+
+#endif /* __SIMPLE_CAM_FRAME_SINK_H__ */
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_stats.cpp - Per-stream frame timing statistics
+ */
+
+#include "frame_stats.h"
+
+#include <iomanip>
+
+FrameStats::FrameStats()
+{
+	reset();
+}
+
+void FrameStats::reset(unsigned int warmup)
+{
+	captureLatency_.reset();
+	dispatchLatency_.reset();
+	interval_.reset();
+	jitter_.reset();
+	gaps_.reset();
+
+	frames_ = 0;
+	dropped_ = 0;
+	bytes_ = 0;
+	firstTimestamp_ = 0;
+
+	warmup_ = warmup;
+	first_ = true;
+	restart_ = false;
+	lastSequence_ = 0;
+	lastTimestamp_ = 0;
+	lastInterval_ = 0;
+}
+
+/*
+ * Mark a discontinuity in the capture, when the camera is restarted. The
+ * next frame isn't compared to the previous one, and the time between them
+ * isn't accounted for in the rates.
+ */
+void FrameStats::restart()
+{
+	restart_ = true;
+}
+
+void FrameStats::record(unsigned int sequence, uint64_t timestamp,
+			uint64_t completed, uint64_t dispatched, uint64_t bytes)
+{
+	if (restart_) {
+		restart_ = false;
+
+		if (!first_ && frames_)
+			firstTimestamp_ += timestamp - lastTimestamp_;
+		first_ = true;
+	}
+
+	/*
+	 * Frame intervals and sequence gaps are relative to the previous
+	 * frame, even if it was captured during warm-up.
+	 */
+	uint64_t interval = first_ ? 0 : timestamp - lastTimestamp_;
+	unsigned int gap = first_ ? 0 : sequence - lastSequence_ - 1;
+	bool hasJitter = !first_ && lastInterval_;
+
+	first_ = false;
+	lastSequence_ = sequence;
+	lastTimestamp_ = timestamp;
+
+	if (warmup_) {
+		warmup_--;
+		lastInterval_ = interval;
+		return;
+	}
+
+	/*
+	 * The rates are computed over the intervals between the first
+	 * accounted frame and the last one, so the data of the first frame
+	 * isn't accounted for.
+	 */
+	if (frames_++)
+		bytes_ += bytes;
+	else
+		firstTimestamp_ = timestamp;
+
+	captureLatency_.record(completed - timestamp);
+	dispatchLatency_.record(dispatched - completed);
+
+	if (gap) {
+		dropped_ += gap;
+		gaps_.record(gap);
+	}
+
+	if (!interval)
+		return;
+
+	/* Intervals spanning dropped frames would skew the jitter. */
+	if (!gap) {
+		interval_.record(interval);
+
+		if (hasJitter)
+			jitter_.record(interval > lastInterval_
+				       ? interval - lastInterval_
+				       : lastInterval_ - interval);
+	}
+
+	lastInterval_ = gap ? 0 : interval;
+}
+
+double FrameStats::frameRate() const
+{
+	if (frames_ < 2)
+		return 0.0;
+
+	return (frames_ - 1) * 1e9 / (lastTimestamp_ - firstTimestamp_);
+}
+
+double FrameStats::byteRate() const
+{
+	if (frames_ < 2)
+		return 0.0;
+
+	return bytes_ * 1e9 / (lastTimestamp_ - firstTimestamp_);
+}
+
+namespace {
+
+void reportTimes(std::ostream &out, const std::string &prefix,
+		 const char *name, const Histogram &histogram)
+{
+	if (!histogram.count())
+		return;
+
+	auto ms = [](double ns) { return ns / 1000000.0; };
+
+	out << prefix << "  " << std::left << std::setw(18) << name << std::right
+	    << std::fixed << std::setprecision(3)
+	    << " min " << ms(histogram.min())
+	    << " mean " << ms(histogram.mean())
+	    << " p50 " << ms(histogram.percentile(50))
+	    << " p90 " << ms(histogram.percentile(90))
+	    << " p99 " << ms(histogram.percentile(99))
+	    << " p99.9 " << ms(histogram.percentile(99.9))
+	    << " max " << ms(histogram.max()) << " ms"
+	    << std::defaultfloat << std::endl;
+}
+
+} /* namespace */
+
+void FrameStats::report(std::ostream &out, const std::string &prefix) const
+{
+	uint64_t total = frames_ + dropped_;
+
+	out << prefix << frames_ << " frames, " << dropped_ << " dropped";
+	if (total)
+		out << " (" << std::fixed << std::setprecision(2)
+		    << dropped_ * 100.0 / total << "%)" << std::defaultfloat;
+	if (frames_ >= 2)
+		out << ", " << std::fixed << std::setprecision(2) << frameRate()
+		    << " fps, " << byteRate() / 1000000.0 << " MB/s"
+		    << std::defaultfloat;
+	out << std::endl;
+
+	reportTimes(out, prefix, "capture latency", captureLatency_);
+	reportTimes(out, prefix, "dispatch latency", dispatchLatency_);
+	reportTimes(out, prefix, "frame interval", interval_);
+	reportTimes(out, prefix, "interval jitter", jitter_);
+
+	if (gaps_.count())
+		out << prefix << "  sequence gaps      " << gaps_.count()
+		    << " gaps, p50 " << gaps_.percentile(50) << " max "
+		    << gaps_.max() << " frames" << std::endl;
+}
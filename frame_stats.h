@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * frame_stats.h - Per-stream frame timing statistics
+ */
+#ifndef __SIMPLE_CAM_FRAME_STATS_H__
+#define __SIMPLE_CAM_FRAME_STATS_H__
+
+#include <ostream>
+#include <stdint.h>
+#include <string>
+
+#include "histogram.h"
+
+/*
+ * FrameStats accumulates timing statistics for the frames of one stream:
+ *
+ * - the capture latency, from the sensor timestamp to the request completion
+ *   notification in the camera manager thread
+ * - the dispatch latency, from the completion notification to the processing
+ *   of the request in the session thread, which is the time spent in the
+ *   event loop queue
+ * - the frame interval between consecutive sensor timestamps, and its jitter
+ *   as the difference between consecutive intervals
+ * - the gaps in the sequence numbers, which are frames dropped by the camera
+ * - the frame rate and data rate, from the sensor timestamps
+ *
+ * All times are in nanoseconds. The first frames, captured while the pipeline
+ * fills up, can be excluded from the statistics.
+ */
+class FrameStats
+{
+public:
+	FrameStats();
+
+	void reset(unsigned int warmup = 0);
+	void restart();
+	void record(unsigned int sequence, uint64_t timestamp,
+		    uint64_t completed, uint64_t dispatched, uint64_t bytes);
+
+	uint64_t frames() const { return frames_; }
+	uint64_t dropped() const { return dropped_; }
+	uint64_t bytes() const { return bytes_; }
+
+	const Histogram &captureLatency() const { return captureLatency_; }
+	const Histogram &dispatchLatency() const { return dispatchLatency_; }
+
+	double frameRate() const;
+	double byteRate() const;
+
+	void report(std::ostream &out, const std::string &prefix) const;
+
+private:
+	Histogram captureLatency_;
+	Histogram dispatchLatency_;
+	Histogram interval_;
+	Histogram jitter_;
+	Histogram gaps_;
+
+	uint64_t frames_;
+	uint64_t dropped_;
+	uint64_t bytes_;
+	uint64_t firstTimestamp_;
+
+	unsigned int warmup_;
+	bool first_;
+	bool restart_;
+	unsigned int lastSequence_;
+	uint64_t lastTimestamp_;
+	uint64_t lastInterval_;
+};
+
+#endif /* __SIMPLE_CAM_FRAME_STATS_H__ */
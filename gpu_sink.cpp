@@ -0,0 +1,424 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * gpu_sink.cpp - Frame sink importing frames as OpenGL ES textures
+ */
+
+#include "gpu_sink.h"
+
+#include <errno.h>
+#include <iostream>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <libcamera/formats.h>
+
+using namespace libcamera;
+
+namespace {
+
+/* Time to wait for the GPU to release the frames when stopping. */
+constexpr int kFenceTimeoutMs = 1000;
+
+/* Number of signalled fences handled at once. */
+constexpr int kMaxFenceEvents = 16;
+
+bool hasExtension(const char *extensions, const char *name)
+{
+	if (!extensions)
+		return false;
+
+	size_t length = strlen(name);
+
+	for (const char *str = extensions; (str = strstr(str, name)); str += length) {
+		if ((str == extensions || str[-1] == ' ') &&
+		    (str[length] == ' ' || str[length] == '\0'))
+			return true;
+	}
+
+	return false;
+}
+
+/* The chroma planes of planar YUV formats have half the luma stride. */
+unsigned int planePitch(const PixelFormat &format, unsigned int stride,
+			unsigned int plane)
+{
+	if (plane && (format == formats::YUV420 || format == formats::YVU420 ||
+		      format == formats::YUV422 || format == formats::YVU422))
+		return stride / 2;
+
+	return stride;
+}
+
+template<typename T>
+T getProc(const char *name)
+{
+	return reinterpret_cast<T>(eglGetProcAddress(name));
+}
+
+} /* namespace */
+
+GpuSink::GpuSink(EventLoop *loop, const CameraConfiguration &config,
+		 const FrameBufferAllocator &allocator)
+	: loop_(loop), display_(EGL_NO_DISPLAY), context_(EGL_NO_CONTEXT),
+	  nativeFences_(false), epollFd_(-1), eglCreateImageKHR_(nullptr),
+	  eglDestroyImageKHR_(nullptr), eglCreateSyncKHR_(nullptr),
+	  eglDestroySyncKHR_(nullptr), eglDupNativeFenceFDANDROID_(nullptr),
+	  glEGLImageTargetTexture2DOES_(nullptr), frames_(0), dropped_(0)
+{
+	for (const StreamConfiguration &cfg : config) {
+		for (const std::unique_ptr<FrameBuffer> &buffer : allocator.buffers(cfg.stream())) {
+			ids_[buffer.get()] = buffers_.size();
+			buffers_.push_back({ buffer.get(), cfg.pixelFormat, cfg.size,
+					     cfg.stride, EGL_NO_IMAGE_KHR, 0,
+					     nullptr, EGL_NO_SYNC_KHR, -1 });
+		}
+	}
+}
+
+GpuSink::~GpuSink()
+{
+	stop();
+}
+
+/*
+ * Applications process the frame here, for instance with a compute shader
+ * sampling the texture. The texture target is GL_TEXTURE_EXTERNAL_OES, and
+ * the GPU converts YUV formats to RGB when sampling.
+ */
+void GpuSink::processTexture(Frame *frame, GLuint texture)
+{
+}
+
+int GpuSink::initDisplay()
+{
+	/* Prefer a surfaceless display, which doesn't need a window system. */
+	const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+		auto getPlatformDisplay =
+			getProc<PFNEGLGETPLATFORMDISPLAYEXTPROC>("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+						      EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (display_ == EGL_NO_DISPLAY)
+		display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+		std::cerr << "Failed to initialize EGL display" << std::endl;
+		display_ = EGL_NO_DISPLAY;
+		return -ENODEV;
+	}
+
+	const char *extensions = eglQueryString(display_, EGL_EXTENSIONS);
+	if (!hasExtension(extensions, "EGL_EXT_image_dma_buf_import") ||
+	    !hasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+		std::cerr << "EGL display doesn't support dmabuf import" << std::endl;
+		return -ENOTSUP;
+	}
+
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	if (!hasExtension(extensions, "EGL_KHR_no_config_context")) {
+		static const EGLint configAttribs[] = {
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+			EGL_NONE,
+		};
+		EGLint count;
+
+		if (!eglChooseConfig(display_, configAttribs, &config, 1, &count) ||
+		    !count) {
+			std::cerr << "No suitable EGL configuration" << std::endl;
+			return -ENOTSUP;
+		}
+	}
+
+	static const EGLint contextAttribs[] = {
+		EGL_CONTEXT_CLIENT_VERSION, 2,
+		EGL_NONE,
+	};
+
+	eglBindAPI(EGL_OPENGL_ES_API);
+	context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttribs);
+	if (context_ == EGL_NO_CONTEXT) {
+		std::cerr << "Failed to create EGL context" << std::endl;
+		return -ENOTSUP;
+	}
+
+	if (!makeCurrent()) {
+		std::cerr << "Failed to make EGL context current" << std::endl;
+		return -ENOTSUP;
+	}
+
+	const char *glExtensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+	if (!hasExtension(glExtensions, "GL_OES_EGL_image_external")) {
+		std::cerr << "GL context doesn't support external images" << std::endl;
+		return -ENOTSUP;
+	}
+
+	eglCreateImageKHR_ = getProc<PFNEGLCREATEIMAGEKHRPROC>("eglCreateImageKHR");
+	eglDestroyImageKHR_ = getProc<PFNEGLDESTROYIMAGEKHRPROC>("eglDestroyImageKHR");
+	glEGLImageTargetTexture2DOES_ =
+		getProc<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>("glEGLImageTargetTexture2DOES");
+	if (!eglCreateImageKHR_ || !eglDestroyImageKHR_ ||
+	    !glEGLImageTargetTexture2DOES_)
+		return -ENOTSUP;
+
+	eglCreateSyncKHR_ = getProc<PFNEGLCREATESYNCKHRPROC>("eglCreateSyncKHR");
+	eglDestroySyncKHR_ = getProc<PFNEGLDESTROYSYNCKHRPROC>("eglDestroySyncKHR");
+	eglDupNativeFenceFDANDROID_ =
+		getProc<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>("eglDupNativeFenceFDANDROID");
+	nativeFences_ = hasExtension(extensions, "EGL_ANDROID_native_fence_sync") &&
+			eglCreateSyncKHR_ && eglDestroySyncKHR_ &&
+			eglDupNativeFenceFDANDROID_;
+
+	return 0;
+}
+
+/* Import all the planes of a buffer to a single EGLImage, and bind a texture to it. */
+int GpuSink::importBuffer(GpuBuffer *buffer)
+{
+	static const EGLint planeAttribs[3][3] = {
+		{ EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE0_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE1_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE2_PITCH_EXT },
+	};
+
+	const std::vector<FrameBuffer::Plane> &planes = buffer->buffer->planes();
+	if (planes.empty() || planes.size() > 3)
+		return -EINVAL;
+
+	/* libcamera pixel formats use the DRM fourcc codes. */
+	std::vector<EGLint> attribs = {
+		EGL_WIDTH, static_cast<EGLint>(buffer->size.width),
+		EGL_HEIGHT, static_cast<EGLint>(buffer->size.height),
+		EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(buffer->format.fourcc()),
+	};
+
+	for (unsigned int i = 0; i < planes.size(); ++i) {
+		attribs.insert(attribs.end(), {
+			planeAttribs[i][0], planes[i].fd.get(),
+			planeAttribs[i][1], static_cast<EGLint>(planes[i].offset),
+			planeAttribs[i][2],
+			static_cast<EGLint>(planePitch(buffer->format, buffer->stride, i)),
+		});
+	}
+
+	attribs.push_back(EGL_NONE);
+
+	buffer->image = eglCreateImageKHR_(display_, EGL_NO_CONTEXT,
+					   EGL_LINUX_DMA_BUF_EXT, nullptr,
+					   attribs.data());
+	if (buffer->image == EGL_NO_IMAGE_KHR) {
+		std::cerr << "Failed to import " << buffer->format.toString()
+			  << " buffer: EGL error " << eglGetError() << std::endl;
+		return -EINVAL;
+	}
+
+	glGenTextures(1, &buffer->texture);
+	glBindTexture(GL_TEXTURE_EXTERNAL_OES, buffer->texture);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glEGLImageTargetTexture2DOES_(GL_TEXTURE_EXTERNAL_OES, buffer->image);
+	glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		std::cerr << "Failed to bind texture: GL error " << error << std::endl;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+bool GpuSink::makeCurrent()
+{
+	if (eglGetCurrentContext() == context_)
+		return true;
+
+	return eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_);
+}
+
+int GpuSink::start()
+{
+	int ret = initDisplay();
+	if (ret < 0) {
+		stop();
+		return ret;
+	}
+
+	for (GpuBuffer &buffer : buffers_) {
+		ret = importBuffer(&buffer);
+		if (ret < 0) {
+			stop();
+			return ret;
+		}
+	}
+
+	if (nativeFences_) {
+		epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd_ < 0) {
+			ret = -errno;
+			std::cerr << "Failed to create fence epoll: "
+				  << strerror(-ret) << std::endl;
+			stop();
+			return ret;
+		}
+
+		loop_->addFdEvent(epollFd_, EventLoop::Read,
+				  [this]() { releaseFrames(); });
+	}
+
+	std::cout << "Imported " << buffers_.size() << " buffers to "
+		  << reinterpret_cast<const char *>(glGetString(GL_RENDERER))
+		  << (nativeFences_ ? "" : ", without native fences") << std::endl;
+
+	/* The context is made current again in the session thread. */
+	eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	return 0;
+}
+
+void GpuSink::stop()
+{
+	if (display_ == EGL_NO_DISPLAY)
+		return;
+
+	/* Wait for the GPU to be done with the frames it still holds. */
+	for (GpuBuffer &buffer : buffers_) {
+		if (!buffer.frame)
+			continue;
+
+		if (buffer.fence >= 0) {
+			struct pollfd pfd = { buffer.fence, POLLIN, 0 };
+			poll(&pfd, 1, kFenceTimeoutMs);
+		}
+
+		releaseFrame(&buffer);
+	}
+
+	if (epollFd_ >= 0) {
+		loop_->removeFdEvent(epollFd_);
+		close(epollFd_);
+		epollFd_ = -1;
+	}
+
+	/*
+	 * The context can't be made current if it is still current in the
+	 * session thread, which has exited. The textures are then deleted
+	 * along with the context.
+	 */
+	bool current = context_ != EGL_NO_CONTEXT && makeCurrent();
+
+	for (GpuBuffer &buffer : buffers_) {
+		if (buffer.texture && current)
+			glDeleteTextures(1, &buffer.texture);
+		buffer.texture = 0;
+
+		if (buffer.image != EGL_NO_IMAGE_KHR)
+			eglDestroyImageKHR_(display_, buffer.image);
+		buffer.image = EGL_NO_IMAGE_KHR;
+	}
+
+	if (current)
+		eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (context_ != EGL_NO_CONTEXT)
+		eglDestroyContext(display_, context_);
+
+	/* The display is shared by all the sinks, and is not terminated. */
+	context_ = EGL_NO_CONTEXT;
+	display_ = EGL_NO_DISPLAY;
+
+	if (frames_)
+		std::cout << "GPU: processed " << frames_ << " frames" << std::endl;
+	if (dropped_)
+		std::cout << "GPU: dropped " << dropped_ << " frames" << std::endl;
+}
+
+void GpuSink::processFrame(Frame *frame)
+{
+	if (context_ == EGL_NO_CONTEXT ||
+	    frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	auto iter = ids_.find(frame->buffer());
+	if (iter == ids_.end())
+		return;
+
+	if (!makeCurrent()) {
+		dropped_++;
+		return;
+	}
+
+	GpuBuffer &buffer = buffers_[iter->second];
+
+	processTexture(frame, buffer.texture);
+	frames_++;
+
+	buffer.frame = frame;
+	frame->acquire();
+
+	if (nativeFences_) {
+		buffer.sync = eglCreateSyncKHR_(display_, EGL_SYNC_NATIVE_FENCE_ANDROID,
+						nullptr);
+
+		/* The fence file descriptor exists once the commands are flushed. */
+		glFlush();
+
+		if (buffer.sync != EGL_NO_SYNC_KHR)
+			buffer.fence = eglDupNativeFenceFDANDROID_(display_, buffer.sync);
+
+		if (buffer.fence >= 0) {
+			struct epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.u32 = iter->second;
+
+			if (!epoll_ctl(epollFd_, EPOLL_CTL_ADD, buffer.fence, &event))
+				return;
+		}
+	}
+
+	/* Without a native fence, wait for the GPU synchronously. */
+	glFinish();
+	releaseFrame(&buffer);
+}
+
+/* Release the frames of all the fences that have signalled. */
+void GpuSink::releaseFrames()
+{
+	struct epoll_event events[kMaxFenceEvents];
+
+	int count = epoll_wait(epollFd_, events, kMaxFenceEvents, 0);
+	for (int i = 0; i < count; ++i)
+		releaseFrame(&buffers_[events[i].data.u32]);
+}
+
+/* Give a frame back to the camera once the GPU is done with its texture. */
+void GpuSink::releaseFrame(GpuBuffer *buffer)
+{
+	if (buffer->fence >= 0) {
+		epoll_ctl(epollFd_, EPOLL_CTL_DEL, buffer->fence, nullptr);
+		close(buffer->fence);
+		buffer->fence = -1;
+	}
+
+	if (buffer->sync != EGL_NO_SYNC_KHR) {
+		eglDestroySyncKHR_(display_, buffer->sync);
+		buffer->sync = EGL_NO_SYNC_KHR;
+	}
+
+	Frame *frame = buffer->frame;
+	buffer->frame = nullptr;
+
+	if (frame)
+		frame->release();
+}
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * gpu_sink.h - Frame sink importing frames as OpenGL ES textures
+ */
+#ifndef __SIMPLE_CAM_GPU_SINK_H__
+#define __SIMPLE_CAM_GPU_SINK_H__
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/framebuffer.h>
+#include <libcamera/framebuffer_allocator.h>
+
+#include "event_loop.h"
+#include "frame_sink.h"
+
+/*
+ * The GpuSink hands the captured frames to the GPU as OpenGL ES textures,
+ * without copying the image data through the CPU.
+ *
+ * Each buffer is imported once, when the sink starts, as an EGLImage created
+ * from the dmabufs of its planes, and bound to an external texture. For every
+ * captured frame, processTexture() is called with the texture of the buffer
+ * and the GL context current.
+ *
+ * The frame is held until the GPU is done with the texture. A native fence is
+ * inserted in the command stream after processTexture(), and the frame is
+ * released, and the buffer given back to the camera, when the fence signals.
+ * When native fences are not supported, the GPU work is waited for
+ * synchronously instead.
+ *
+ * The fences of all the buffers are watched through an epoll instance of the
+ * sink, registered with the event loop once when the sink starts, so that no
+ * event is added to or removed from the loop for every frame.
+ *
+ * The EGL display is a surfaceless display, the sink doesn't render to the
+ * screen. It runs in the session thread, as the fences are watched by the
+ * event loop of the camera session.
+ */
+class GpuSink : public FrameSink
+{
+public:
+	GpuSink(EventLoop *loop, const libcamera::CameraConfiguration &config,
+		const libcamera::FrameBufferAllocator &allocator);
+	~GpuSink();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+
+protected:
+	virtual void processTexture(Frame *frame, GLuint texture);
+
+private:
+	struct GpuBuffer {
+		const libcamera::FrameBuffer *buffer;
+		libcamera::PixelFormat format;
+		libcamera::Size size;
+		unsigned int stride;
+
+		EGLImageKHR image;
+		GLuint texture;
+
+		/* The frame being processed by the GPU, and its fence. */
+		Frame *frame;
+		EGLSyncKHR sync;
+		int fence;
+	};
+
+	int initDisplay();
+	int importBuffer(GpuBuffer *buffer);
+	bool makeCurrent();
+	void releaseFrames();
+	void releaseFrame(GpuBuffer *buffer);
+
+	EventLoop *loop_;
+
+	EGLDisplay display_;
+	EGLContext context_;
+	bool nativeFences_;
+	int epollFd_;
+
+	PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_;
+	PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_;
+	PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR_;
+	PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR_;
+	PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID_;
+	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_;
+
+	std::vector<GpuBuffer> buffers_;
+	std::map<const libcamera::FrameBuffer *, unsigned int> ids_;
+
+	uint64_t frames_;
+	uint64_t dropped_;
+};
+
+#endif /* __SIMPLE_CAM_GPU_SINK_H__ */
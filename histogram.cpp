@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * histogram.cpp - Log-linear histogram of integer values
+ */
+
+#include "histogram.h"
+
+#include <algorithm>
+
+Histogram::Histogram()
+{
+	reset();
+}
+
+void Histogram::reset()
+{
+	buckets_.fill(0);
+	count_ = 0;
+	sum_ = 0;
+	min_ = UINT64_MAX;
+	max_ = 0;
+}
+
+unsigned int Histogram::bucketIndex(uint64_t value)
+{
+	if (value < kSubBuckets)
+		return value;
+
+	/*
+	 * Keep the kSubBucketBits + 1 most significant bits of the value. The
+	 * position of the most significant bit selects the power of two range,
+	 * and the next kSubBucketBits bits the linear bucket within the range.
+	 */
+	unsigned int msb = 63 - __builtin_clzll(value);
+	unsigned int shift = msb - kSubBucketBits;
+	unsigned int top = value >> shift;
+
+	return (shift + 1) * kSubBuckets + top - kSubBuckets;
+}
+
+/* Return the highest value that falls in the bucket. */
+uint64_t Histogram::bucketValue(unsigned int index)
+{
+	if (index < kSubBuckets)
+		return index;
+
+	unsigned int shift = index / kSubBuckets - 1;
+	uint64_t top = index % kSubBuckets + kSubBuckets;
+
+	return (top << shift) + (1ULL << shift) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+	buckets_[bucketIndex(value)]++;
+	count_++;
+	sum_ += value;
+	min_ = std::min(min_, value);
+	max_ = std::max(max_, value);
+}
+
+void Histogram::merge(const Histogram &other)
+{
+	for (unsigned int i = 0; i < kNumBuckets; ++i)
+		buckets_[i] += other.buckets_[i];
+
+	count_ += other.count_;
+	sum_ += other.sum_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+}
+
+/*
+ * Return the value below which the given percentage of the recorded values
+ * fall, within the precision of the histogram.
+ */
+uint64_t Histogram::percentile(double percentile) const
+{
+	if (!count_)
+		return 0;
+
+	uint64_t target = static_cast<uint64_t>(percentile / 100.0 * count_ + 0.5);
+	target = std::clamp<uint64_t>(target, 1, count_);
+
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < kNumBuckets; ++i) {
+		total += buckets_[i];
+		if (total >= target)
+			return std::min(bucketValue(i), max_);
+	}
+
+	return max_;
+}
@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * histogram.h - Log-linear histogram of integer values
+ */
+#ifndef __SIMPLE_CAM_HISTOGRAM_H__
+#define __SIMPLE_CAM_HISTOGRAM_H__
+
+#include <array>
+#include <stdint.h>
+
+/*
+ * The histogram covers the whole range of 64-bit values with a constant
+ * relative precision, in the same way as HdrHistogram: values are grouped in
+ * power of two ranges, each of them split in kSubBuckets linear buckets. This
+ * bounds the error to 1 / kSubBuckets (about 3%) with a fixed memory
+ * footprint, and recording a value is a handful of integer operations.
+ */
+class Histogram
+{
+public:
+	static constexpr unsigned int kSubBucketBits = 5;
+	static constexpr unsigned int kSubBuckets = 1 << kSubBucketBits;
+
+	Histogram();
+
+	void record(uint64_t value);
+	void merge(const Histogram &other);
+	void reset();
+
+	uint64_t count() const { return count_; }
+	uint64_t min() const { return count_ ? min_ : 0; }
+	uint64_t max() const { return max_; }
+	double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+	uint64_t percentile(double percentile) const;
+
+private:
+	static constexpr unsigned int kNumBuckets =
+		(64 - kSubBucketBits + 1) * kSubBuckets;
+
+	static unsigned int bucketIndex(uint64_t value);
+	static uint64_t bucketValue(unsigned int index);
+
+	std::array<uint64_t, kNumBuckets> buckets_;
+	uint64_t count_;
+	uint64_t sum_;
+	uint64_t min_;
+	uint64_t max_;
+};
+
+#endif /* __SIMPLE_CAM_HISTOGRAM_H__ */
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * image.cpp - Memory mapped access to FrameBuffer planes
+ */
+
+#include "image.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <map>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "numa.h"
+
+using namespace libcamera;
+
+std::unique_ptr<Image> Image::fromFrameBuffer(const FrameBuffer *buffer, MapMode mode)
+{
+	std::unique_ptr<Image> image{ new Image() };
+
+	if (buffer->planes().empty())
+		return nullptr;
+
+	/*
+	 * Planes of a multi-planar format are often stored in the same dmabuf
+	 * at different offsets. Compute the length to map for each dmabuf, so
+	 * each of them is mapped once only, regardless of how many planes it
+	 * holds.
+	 */
+	struct MappedBufferInfo {
+		uint8_t *address = nullptr;
+		size_t mapLength = 0;
+		size_t dmabufLength = 0;
+	};
+	std::map<int, MappedBufferInfo> mappedBuffers;
+
+	for (const FrameBuffer::Plane &plane : buffer->planes()) {
+		const int fd = plane.fd.get();
+
+		if (mappedBuffers.find(fd) == mappedBuffers.end()) {
+			const off_t length = lseek(fd, 0, SEEK_END);
+			if (length < 0) {
+				std::cerr << "Failed to get size of dmabuf: "
+					  << strerror(errno) << std::endl;
+				return nullptr;
+			}
+
+			mappedBuffers[fd].dmabufLength = length;
+		}
+
+		MappedBufferInfo &info = mappedBuffers[fd];
+		if (plane.offset > info.dmabufLength ||
+		    plane.length > info.dmabufLength - plane.offset) {
+			std::cerr << "Plane exceeds dmabuf size" << std::endl;
+			return nullptr;
+		}
+
+		info.mapLength = std::max<size_t>(info.mapLength,
+						  plane.offset + plane.length);
+	}
+
+	int mmapFlags = 0;
+	if (mode & ReadOnly)
+		mmapFlags |= PROT_READ;
+	if (mode & WriteOnly)
+		mmapFlags |= PROT_WRITE;
+
+	for (auto &[fd, info] : mappedBuffers) {
+		void *address = mmap(nullptr, info.mapLength, mmapFlags,
+				     MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED) {
+			std::cerr << "Failed to mmap plane: " << strerror(errno)
+				  << std::endl;
+			return nullptr;
+		}
+
+		info.address = static_cast<uint8_t *>(address);
+		image->maps_.emplace_back(info.address, info.mapLength);
+	}
+
+	for (const FrameBuffer::Plane &plane : buffer->planes()) {
+		const MappedBufferInfo &info = mappedBuffers[plane.fd.get()];
+		image->planes_.emplace_back(info.address + plane.offset,
+					    plane.length);
+	}
+
+	return image;
+}
+
+/*
+ * Lock the mappings in memory, to avoid page faults when accessing the data.
+ * This is limited by RLIMIT_MEMLOCK for unprivileged processes.
+ */
+int Image::lock()
+{
+	for (Span<uint8_t> &map : maps_) {
+		if (mlock(map.data(), map.size()) < 0)
+			return -errno;
+	}
+
+	return 0;
+}
+
+/* Prefer the given NUMA node for the pages of the mappings. */
+int Image::bind(unsigned int node)
+{
+	for (Span<uint8_t> &map : maps_) {
+		int ret = numaBindMemory(map.data(), map.size(), node);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Return the NUMA node holding the first mapping, where the data starts. */
+int Image::node() const
+{
+	return numaMemoryNode(maps_[0].data(), maps_[0].size());
+}
+
+Image::~Image()
+{
+	for (Span<uint8_t> &map : maps_)
+		munmap(map.data(), map.size());
+}
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * image.h - Memory mapped access to FrameBuffer planes
+ */
+#ifndef __SIMPLE_CAM_IMAGE_H__
+#define __SIMPLE_CAM_IMAGE_H__
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/span.h>
+
+#include <libcamera/framebuffer.h>
+
+class Image
+{
+public:
+	enum MapMode {
+		ReadOnly = 1 << 0,
+		WriteOnly = 1 << 1,
+		ReadWrite = ReadOnly | WriteOnly,
+	};
+
+	static std::unique_ptr<Image> fromFrameBuffer(const libcamera::FrameBuffer *buffer,
+						      MapMode mode);
+
+	~Image();
+
+	Image(const Image &) = delete;
+	Image &operator=(const Image &) = delete;
+
+	int lock();
+	int bind(unsigned int node);
+	int node() const;
+
+	unsigned int numPlanes() const { return planes_.size(); }
+
+	libcamera::Span<uint8_t> data(unsigned int plane) { return planes_[plane]; }
+	libcamera::Span<const uint8_t> data(unsigned int plane) const { return planes_[plane]; }
+
+private:
+	Image() = default;
+
+	std::vector<libcamera::Span<uint8_t>> maps_;
+	std::vector<libcamera::Span<uint8_t>> planes_;
+};
+
+#endif /* __SIMPLE_CAM_IMAGE_H__ */
@@ -0,0 +1,215 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * metadata_filter.h - Compile-time selection of request metadata controls
+ */
+#ifndef __SIMPLE_CAM_METADATA_FILTER_H__
+#define __SIMPLE_CAM_METADATA_FILTER_H__
+
+#include <array>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+/*
+ * A MetadataFilter extracts a fixed set of controls from the metadata of
+ * completed requests, selected at compile time:
+ *
+ *   MetadataFilter<controls::ExposureTime, controls::AnalogueGain> filter;
+ *   MetadataFilter<...>::Values values;
+ *
+ *   filter.extract(request->metadata(), &values);
+ *   std::optional<int32_t> exposure = values.get<controls::ExposureTime>();
+ *
+ * The numerical IDs of the controls are resolved once, when the filter is
+ * constructed. The values are stored in a flat structure, typed after the
+ * controls, and are looked up by index at compile time. Extraction walks the
+ * metadata list once, and doesn't involve any hash lookup, string or memory
+ * allocation.
+ *
+ * Only scalar controls can be selected. A filter can further be restricted at
+ * runtime to a subset of its controls, such as the ones its consumers use:
+ *
+ *   filter.select(decltype(filter)::mask<controls::ExposureTime>());
+ */
+template<const auto &...Controls>
+class MetadataFilter
+{
+	static_assert(sizeof...(Controls) <= 32, "Too many controls");
+
+	template<const auto &Control>
+	using ValueType = typename std::remove_reference_t<decltype(Control)>::type;
+
+	template<const auto &Control>
+	static constexpr size_t indexOf()
+	{
+		size_t index = sizeof...(Controls);
+		size_t i = 0;
+
+		((static_cast<const libcamera::ControlId *>(&Control) ==
+		  static_cast<const libcamera::ControlId *>(&Controls)
+		  ? index = i : 0, i++), ...);
+
+		return index;
+	}
+
+	static constexpr uint32_t kAll =
+		sizeof...(Controls) == 32 ? ~0U : (1U << sizeof...(Controls)) - 1;
+
+public:
+	class Values
+	{
+	public:
+		Values()
+			: values_{}, valid_(0)
+		{
+		}
+
+		template<const auto &Control>
+		std::optional<ValueType<Control>> get() const
+		{
+			constexpr size_t index = indexOf<Control>();
+			static_assert(index < sizeof...(Controls),
+				      "Control not selected by the filter");
+
+			if (!(valid_ & (1U << index)))
+				return std::nullopt;
+
+			return std::get<index>(values_);
+		}
+
+		bool empty() const { return !valid_; }
+
+	private:
+		friend class MetadataFilter;
+
+		std::tuple<ValueType<Controls>...> values_;
+		uint32_t valid_;
+	};
+
+	/* Control<T>::type hides ControlId::type(), hence the cast. */
+	MetadataFilter()
+		: ids_{ Controls.id()... },
+		  types_{ static_cast<const libcamera::ControlId &>(Controls).type()... },
+		  selected_(kAll)
+	{
+	}
+
+	/* Mask of a subset of the controls of the filter, for select(). */
+	template<const auto &...Selected>
+	static constexpr uint32_t mask()
+	{
+		static_assert(((indexOf<Selected>() < sizeof...(Controls)) && ...),
+			      "Control not selected by the filter");
+
+		return ((1U << indexOf<Selected>()) | ... | 0U);
+	}
+
+	/*
+	 * Only extract the controls of the mask. The other controls of the
+	 * filter are still matched, but their values are not stored.
+	 */
+	void select(uint32_t mask) { selected_ = mask & kAll; }
+
+	void extract(const libcamera::ControlList &metadata, Values *values) const
+	{
+		*values = {};
+
+		for (const auto &[id, value] : metadata)
+			match(id, value, values);
+	}
+
+	/*
+	 * Store the value of a single metadata entry if it is selected, and
+	 * return true, or return false otherwise. This allows extracting
+	 * selected controls while walking the metadata for other purposes.
+	 */
+	bool match(unsigned int id, const libcamera::ControlValue &value,
+		   Values *values) const
+	{
+		return match(id, value, values,
+			     std::index_sequence_for<decltype(Controls)...>{});
+	}
+
+	/*
+	 * Store a scalar value of a selected control, such as a value recorded
+	 * in a frame log, converted to the type of the control. Integer values
+	 * are only stored in integer controls, and floating point values in
+	 * floating point controls.
+	 */
+	template<typename T>
+	bool matchScalar(unsigned int id, T scalar, Values *values) const
+	{
+		static_assert(std::is_arithmetic_v<T>, "Scalar value required");
+
+		return matchScalar(id, scalar, values,
+				   std::index_sequence_for<decltype(Controls)...>{});
+	}
+
+private:
+	template<size_t... I>
+	bool match(unsigned int id, const libcamera::ControlValue &value,
+		   Values *values, std::index_sequence<I...>) const
+	{
+		return ((id == ids_[I] && store<I>(value, values)) || ...);
+	}
+
+	template<typename T, size_t... I>
+	bool matchScalar(unsigned int id, T scalar, Values *values,
+			 std::index_sequence<I...>) const
+	{
+		return ((id == ids_[I] && storeScalar<I>(scalar, values)) || ...);
+	}
+
+	template<size_t I, typename T>
+	bool storeScalar(T scalar, Values *values) const
+	{
+		using V = std::tuple_element_t<I, decltype(values->values_)>;
+
+		if (!(selected_ & (1U << I)))
+			return true;
+
+		if constexpr (std::is_floating_point_v<V> == std::is_floating_point_v<T>) {
+			std::get<I>(values->values_) = static_cast<V>(scalar);
+			values->valid_ |= 1U << I;
+		}
+
+		return true;
+	}
+
+	template<size_t I>
+	bool store(const libcamera::ControlValue &value, Values *values) const
+	{
+		using T = std::tuple_element_t<I, decltype(values->values_)>;
+
+		/* Skip unselected values, and values of the wrong type. */
+		if (!(selected_ & (1U << I)) || value.isArray() ||
+		    value.type() != types_[I])
+			return true;
+
+		std::get<I>(values->values_) = value.get<T>();
+		values->valid_ |= 1U << I;
+
+		return true;
+	}
+
+	std::array<unsigned int, sizeof...(Controls)> ids_;
+	std::array<libcamera::ControlType, sizeof...(Controls)> types_;
+	uint32_t selected_;
+};
+
+/* The metadata controls consumers can select for every captured frame. */
+using CaptureMetadataFilter = MetadataFilter<libcamera::controls::ExposureTime,
+					     libcamera::controls::AnalogueGain,
+					     libcamera::controls::SensorTimestamp,
+					     libcamera::controls::FrameDuration>;
+using CaptureMetadata = CaptureMetadataFilter::Values;
+
+#endif /* __SIMPLE_CAM_METADATA_FILTER_H__ */
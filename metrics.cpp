@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * metrics.cpp - Lock-free capture metrics in the Prometheus format
+ */
+
+#include "metrics.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "allocation_counter.h"
+
+namespace {
+
+std::atomic<uint64_t> nextId{ 1 };
+
+} /* namespace */
+
+Metrics::Metrics()
+	: id_(nextId.fetch_add(1, std::memory_order_relaxed)), slots_(1),
+	  gauges_(1), gaugeValues_{}
+{
+}
+
+Metrics::~Metrics() = default;
+
+/*
+ * Allocate a shard for the calling thread. This happens once per thread, and
+ * the shards are kept until the registry is destroyed, so that the values
+ * updated by threads that have exited remain accounted for.
+ */
+Metrics::Shard *Metrics::addShard()
+{
+	/* The allocation happens once, not on every frame. */
+	AllocationScope uncounted(false);
+
+	std::unique_lock<std::mutex> locker(lock_);
+	shards_.push_back(std::make_unique<Shard>());
+	return shards_.back().get();
+}
+
+unsigned int Metrics::allocate(Type type, const std::string &name,
+			       const std::string &labels, const std::string &help,
+			       unsigned int count)
+{
+	std::unique_lock<std::mutex> locker(lock_);
+
+	unsigned int &next = type == GaugeType ? gauges_ : slots_;
+	unsigned int max = type == GaugeType ? kMaxGauges : kMaxSlots;
+
+	if (next + count > max) {
+		std::cerr << "Too many metrics, ignoring " << name << std::endl;
+		return 0;
+	}
+
+	unsigned int slot = next;
+	next += count;
+
+	metrics_.push_back({ name, labels, help, type, slot });
+
+	return slot;
+}
+
+Metrics::Counter Metrics::counter(const std::string &name,
+				  const std::string &labels,
+				  const std::string &help)
+{
+	return Counter(this, allocate(CounterType, name, labels, help, 1));
+}
+
+Metrics::Gauge Metrics::gauge(const std::string &name, const std::string &labels,
+			      const std::string &help)
+{
+	unsigned int slot = allocate(GaugeType, name, labels, help, 1);
+	return Gauge(&gaugeValues_[slot]);
+}
+
+Metrics::LatencyHistogram Metrics::latencyHistogram(const std::string &name,
+						    const std::string &labels,
+						    const std::string &help)
+{
+	unsigned int slot = allocate(HistogramType, name, labels, help,
+				     kLatencyBounds.size() + 2);
+	return LatencyHistogram(this, slot);
+}
+
+/* Sum the values of all threads. The caller holds the lock. */
+uint64_t Metrics::value(unsigned int slot) const
+{
+	uint64_t value = 0;
+
+	for (const std::unique_ptr<Shard> &shard : shards_)
+		value += shard->values[slot].load(std::memory_order_relaxed);
+
+	return value;
+}
+
+/*
+ * Format all the metrics in the Prometheus text format. Metrics sharing a name
+ * are grouped in the same family, in registration order. Latencies are
+ * reported in seconds.
+ */
+std::string Metrics::format() const
+{
+	static const char *const types[] = { "counter", "gauge", "histogram" };
+
+	std::unique_lock<std::mutex> locker(lock_);
+	std::vector<bool> done(metrics_.size());
+	std::ostringstream out;
+
+	out << std::setprecision(9);
+
+	for (unsigned int i = 0; i < metrics_.size(); ++i) {
+		if (done[i])
+			continue;
+
+		const Metric &family = metrics_[i];
+		out << "# HELP " << family.name << " " << family.help << "\n"
+		    << "# TYPE " << family.name << " " << types[family.type] << "\n";
+
+		for (unsigned int j = i; j < metrics_.size(); ++j) {
+			const Metric &metric = metrics_[j];
+			if (done[j] || metric.name != family.name)
+				continue;
+
+			done[j] = true;
+
+			if (metric.type == CounterType) {
+				out << metric.name << "{" << metric.labels << "} "
+				    << value(metric.slot) << "\n";
+				continue;
+			}
+
+			if (metric.type == GaugeType) {
+				out << metric.name << "{" << metric.labels << "} "
+				    << gaugeValues_[metric.slot].load(std::memory_order_relaxed)
+				    << "\n";
+				continue;
+			}
+
+			std::string separator = metric.labels.empty() ? "" : ",";
+			uint64_t count = 0;
+
+			for (unsigned int b = 0; b <= kLatencyBounds.size(); ++b) {
+				count += value(metric.slot + b);
+
+				out << metric.name << "_bucket{" << metric.labels
+				    << separator << "le=\"";
+				if (b < kLatencyBounds.size())
+					out << kLatencyBounds[b] / 1e9;
+				else
+					out << "+Inf";
+				out << "\"} " << count << "\n";
+			}
+
+			out << metric.name << "_sum{" << metric.labels << "} "
+			    << value(metric.slot + kLatencyBounds.size() + 1) / 1e9 << "\n"
+			    << metric.name << "_count{" << metric.labels << "} "
+			    << count << "\n";
+		}
+	}
+
+	return out.str();
+}
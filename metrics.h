@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * metrics.h - Lock-free capture metrics in the Prometheus format
+ */
+#ifndef __SIMPLE_CAM_METRICS_H__
+#define __SIMPLE_CAM_METRICS_H__
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Metrics holds counters, gauges and latency histograms, and formats them in
+ * the Prometheus text exposition format.
+ *
+ * Metrics are registered once, when the capture is set up, and identified by
+ * a name and a set of labels. Registration returns a handle to update them
+ * from any thread.
+ *
+ * Counters and histograms are updated without locks nor atomic
+ * read-modify-write operations: each thread updates its own shard of values,
+ * allocated the first time the thread updates a metric, and the shards are
+ * only summed when the metrics are formatted. Gauges hold a single value,
+ * stored atomically.
+ *
+ * Rates, such as frames or bytes per second, are computed by the monitoring
+ * system from the counters.
+ */
+class Metrics
+{
+	/* Slot zero is a scratch slot for metrics registered past the limits. */
+	static constexpr unsigned int kMaxSlots = 1024;
+	static constexpr unsigned int kMaxGauges = 256;
+
+	struct Shard {
+		std::array<std::atomic<uint64_t>, kMaxSlots> values{};
+	};
+
+public:
+	/* Upper bounds of the latency histogram buckets, in nanoseconds. */
+	static constexpr std::array<uint64_t, 13> kLatencyBounds = {
+		10000, 25000, 50000, 100000, 250000, 500000, 1000000,
+		2500000, 5000000, 10000000, 25000000, 50000000, 100000000,
+	};
+
+	class Counter
+	{
+	public:
+		Counter()
+			: metrics_(nullptr), slot_(0)
+		{
+		}
+
+		void add(uint64_t value = 1) const
+		{
+			if (metrics_)
+				metrics_->increment(slot_, value);
+		}
+
+	private:
+		friend class Metrics;
+
+		Counter(Metrics *metrics, unsigned int slot)
+			: metrics_(metrics), slot_(slot)
+		{
+		}
+
+		Metrics *metrics_;
+		unsigned int slot_;
+	};
+
+	class Gauge
+	{
+	public:
+		Gauge()
+			: value_(nullptr)
+		{
+		}
+
+		void set(int64_t value) const
+		{
+			if (value_)
+				value_->store(value, std::memory_order_relaxed);
+		}
+
+	private:
+		friend class Metrics;
+
+		Gauge(std::atomic<int64_t> *value)
+			: value_(value)
+		{
+		}
+
+		std::atomic<int64_t> *value_;
+	};
+
+	/*
+	 * The histogram uses one slot per bucket, plus one for values above
+	 * the last bound and one for the sum of all values.
+	 */
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram()
+			: metrics_(nullptr), slot_(0)
+		{
+		}
+
+		void record(uint64_t value) const
+		{
+			if (!metrics_)
+				return;
+
+			unsigned int bucket = 0;
+			while (bucket < kLatencyBounds.size() &&
+			       value > kLatencyBounds[bucket])
+				bucket++;
+
+			metrics_->increment(slot_ + bucket, 1);
+			metrics_->increment(slot_ + kLatencyBounds.size() + 1, value);
+		}
+
+	private:
+		friend class Metrics;
+
+		LatencyHistogram(Metrics *metrics, unsigned int slot)
+			: metrics_(metrics), slot_(slot)
+		{
+		}
+
+		Metrics *metrics_;
+		unsigned int slot_;
+	};
+
+	Metrics();
+	~Metrics();
+
+	Counter counter(const std::string &name, const std::string &labels,
+			const std::string &help);
+	Gauge gauge(const std::string &name, const std::string &labels,
+		    const std::string &help);
+	LatencyHistogram latencyHistogram(const std::string &name,
+					  const std::string &labels,
+					  const std::string &help);
+
+	std::string format() const;
+
+private:
+	enum Type {
+		CounterType,
+		GaugeType,
+		HistogramType,
+	};
+
+	struct Metric {
+		std::string name;
+		std::string labels;
+		std::string help;
+		Type type;
+		unsigned int slot;
+	};
+
+	/*
+	 * Only the thread owning a shard updates it, a relaxed load and store
+	 * are enough, and much cheaper than an atomic increment.
+	 */
+	void increment(unsigned int slot, uint64_t value)
+	{
+		std::atomic<uint64_t> &counter = shard()->values[slot];
+		counter.store(counter.load(std::memory_order_relaxed) + value,
+			      std::memory_order_relaxed);
+	}
+
+	/* Each thread caches its shard, tagged with the ID of the registry. */
+	Shard *shard()
+	{
+		static thread_local uint64_t owner = 0;
+		static thread_local Shard *shard = nullptr;
+
+		if (owner != id_) {
+			shard = addShard();
+			owner = id_;
+		}
+
+		return shard;
+	}
+
+	Shard *addShard();
+
+	unsigned int allocate(Type type, const std::string &name,
+			      const std::string &labels, const std::string &help,
+			      unsigned int count);
+	uint64_t value(unsigned int slot) const;
+
+	uint64_t id_;
+
+	mutable std::mutex lock_;
+	std::vector<Metric> metrics_;
+	std::vector<std::unique_ptr<Shard>> shards_;
+	unsigned int slots_;
+	unsigned int gauges_;
+	std::array<std::atomic<int64_t>, kMaxGauges> gaugeValues_;
+};
+
+#endif /* __SIMPLE_CAM_METRICS_H__ */
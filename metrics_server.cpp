@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * metrics_server.cpp - HTTP endpoint exposing the capture metrics
+ */
+
+#include "metrics_server.h"
+
+#include <errno.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#include <event2/buffer.h>
+#include <event2/http.h>
+
+MetricsServer::MetricsServer(EventLoop *loop, const Metrics *metrics)
+	: loop_(loop), metrics_(metrics), http_(nullptr)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+/* Listen on an address given as [HOST:]PORT, on all interfaces by default. */
+int MetricsServer::start(const std::string &address)
+{
+	size_t pos = address.rfind(':');
+	std::string host = pos == std::string::npos ? "0.0.0.0" : address.substr(0, pos);
+	std::string port = pos == std::string::npos ? address : address.substr(pos + 1);
+
+	char *end;
+	unsigned long number = strtoul(port.c_str(), &end, 10);
+	if (port.empty() || *end || number > 65535) {
+		std::cerr << "Invalid metrics address " << address << std::endl;
+		return -EINVAL;
+	}
+
+	http_ = evhttp_new(loop_->base());
+	if (!http_)
+		return -ENOMEM;
+
+	evhttp_set_allowed_methods(http_, EVHTTP_REQ_GET | EVHTTP_REQ_HEAD);
+	evhttp_set_gencb(http_, &MetricsServer::handleRequest, this);
+
+	if (evhttp_bind_socket(http_, host.c_str(), number) < 0) {
+		std::cerr << "Failed to serve metrics on " << address << std::endl;
+		stop();
+		return -EADDRNOTAVAIL;
+	}
+
+	std::cout << "Serving metrics on http://" << host << ":" << number
+		  << "/metrics" << std::endl;
+
+	return 0;
+}
+
+void MetricsServer::stop()
+{
+	if (!http_)
+		return;
+
+	evhttp_free(http_);
+	http_ = nullptr;
+}
+
+void MetricsServer::handleRequest(struct evhttp_request *request, void *arg)
+{
+	MetricsServer *self = static_cast<MetricsServer *>(arg);
+	const char *path = evhttp_uri_get_path(evhttp_request_get_evhttp_uri(request));
+
+	if (!path || strcmp(path, "/metrics")) {
+		evhttp_send_error(request, HTTP_NOTFOUND, nullptr);
+		return;
+	}
+
+	std::string text = self->metrics_->format();
+
+	struct evbuffer *body = evbuffer_new();
+	evbuffer_add(body, text.data(), text.size());
+
+	evhttp_add_header(evhttp_request_get_output_headers(request), "Content-Type",
+			  "text/plain; version=0.0.4");
+	evhttp_send_reply(request, HTTP_OK, "OK", body);
+
+	evbuffer_free(body);
+}
@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * metrics_server.h - HTTP endpoint exposing the capture metrics
+ */
+#ifndef __SIMPLE_CAM_METRICS_SERVER_H__
+#define __SIMPLE_CAM_METRICS_SERVER_H__
+
+#include <string>
+
+#include "event_loop.h"
+#include "metrics.h"
+
+struct evhttp;
+struct evhttp_request;
+
+/*
+ * The MetricsServer serves the metrics in the Prometheus text format on
+ * /metrics, with the libevent HTTP server, from an event loop. Scraping only
+ * sums the per-thread values of the metrics, it doesn't interfere with the
+ * threads capturing and processing frames.
+ */
+class MetricsServer
+{
+public:
+	MetricsServer(EventLoop *loop, const Metrics *metrics);
+	~MetricsServer();
+
+	int start(const std::string &address);
+	void stop();
+
+private:
+	static void handleRequest(struct evhttp_request *request, void *arg);
+
+	EventLoop *loop_;
+	const Metrics *metrics_;
+	struct evhttp *http_;
+};
+
+#endif /* __SIMPLE_CAM_METRICS_SERVER_H__ */
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * mpsc_queue.h - Bounded lock-free multi-producer single-consumer queue
+ */
+#ifndef __SIMPLE_CAM_MPSC_QUEUE_H__
+#define __SIMPLE_CAM_MPSC_QUEUE_H__
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <utility>
+
+/*
+ * The queue is a ring of pre-allocated slots, each tagged with a sequence
+ * number that tells producers and the consumer whether the slot is free or
+ * holds a value. Producers claim slots with a single compare-and-swap on the
+ * head index, the consumer owns the tail index exclusively. No memory is
+ * allocated after construction, and neither side ever blocks the other.
+ *
+ * The element type must be default constructible and move assignable, as
+ * values are moved in and out of the slots.
+ */
+template<typename T>
+class MpscQueue
+{
+public:
+	MpscQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size <<= 1;
+
+		slots_ = std::make_unique<Slot[]>(size);
+		mask_ = size - 1;
+
+		for (size_t i = 0; i < size; ++i)
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+
+		head_.store(0, std::memory_order_relaxed);
+		tail_ = 0;
+	}
+
+	MpscQueue(const MpscQueue &) = delete;
+	MpscQueue &operator=(const MpscQueue &) = delete;
+
+	size_t capacity() const { return mask_ + 1; }
+
+	/* Can be called from any thread. Returns false if the queue is full. */
+	bool push(T &&value)
+	{
+		size_t pos = head_.load(std::memory_order_relaxed);
+		Slot *slot;
+
+		for (;;) {
+			slot = &slots_[pos & mask_];
+			size_t seq = slot->sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = static_cast<ptrdiff_t>(seq - pos);
+
+			if (diff == 0) {
+				if (head_.compare_exchange_weak(pos, pos + 1,
+								std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = head_.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->value = std::move(value);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/* Must only be called from the consumer thread. */
+	bool pop(T *value)
+	{
+		Slot *slot = &slots_[tail_ & mask_];
+		size_t seq = slot->sequence.load(std::memory_order_acquire);
+
+		if (seq != tail_ + 1)
+			return false;
+
+		*value = std::move(slot->value);
+		slot->sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+		tail_++;
+
+		return true;
+	}
+
+private:
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	size_t mask_;
+
+	/* Keep the producer and consumer indexes on separate cache lines. */
+	alignas(64) std::atomic<size_t> head_;
+	alignas(64) size_t tail_;
+};
+
+#endif /* __SIMPLE_CAM_MPSC_QUEUE_H__ */
@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * network_sink.cpp - Frame sink streaming frames over TCP
+ */
+
+#include "network_sink.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/errqueue.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace libcamera;
+
+namespace {
+
+constexpr char kMagic[4] = { 'S', 'C', 'N', 'F' };
+
+} /* namespace */
+
+NetworkSink::NetworkSink(EventLoop *loop, const std::string &address,
+			 size_t queueSize)
+	: loop_(loop), address_(address), queueSize_(queueSize), fd_(-1),
+	  zerocopy_(false), writable_(false), batches_(queueSize + 1), head_(0),
+	  send_(0), tail_(0), heldFrames_(0), nextId_(0), completedId_(0),
+	  frames_(0), bytes_(0), copied_(0), failed_(false)
+{
+}
+
+NetworkSink::~NetworkSink()
+{
+	stop();
+}
+
+int NetworkSink::start()
+{
+	size_t pos = address_.rfind(':');
+	if (pos == std::string::npos) {
+		std::cerr << "Invalid address " << address_ << std::endl;
+		return -EINVAL;
+	}
+
+	std::string host = address_.substr(0, pos);
+	std::string port = address_.substr(pos + 1);
+
+	struct addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	struct addrinfo *result;
+	int ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+	if (ret) {
+		std::cerr << "Failed to resolve " << address_ << ": "
+			  << gai_strerror(ret) << std::endl;
+		return -EINVAL;
+	}
+
+	for (struct addrinfo *ai = result; ai; ai = ai->ai_next) {
+		fd_ = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+			     ai->ai_protocol);
+		if (fd_ < 0)
+			continue;
+
+		if (!connect(fd_, ai->ai_addr, ai->ai_addrlen))
+			break;
+
+		close(fd_);
+		fd_ = -1;
+	}
+
+	freeaddrinfo(result);
+
+	if (fd_ < 0) {
+		std::cerr << "Failed to connect to " << address_ << std::endl;
+		return -ECONNREFUSED;
+	}
+
+	/*
+	 * Fall back to regular sends, which copy the data to the socket
+	 * buffers, if zero-copy transmission isn't supported.
+	 */
+	int one = 1;
+	zerocopy_ = !setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+	if (!zerocopy_)
+		std::cout << address_ << ": zero-copy not supported" << std::endl;
+
+	setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+	head_ = send_ = tail_ = 0;
+	batch(tail_) = {};
+	heldFrames_ = 0;
+	nextId_ = 0;
+	completedId_ = 0;
+	frames_ = 0;
+	bytes_ = 0;
+	copied_ = 0;
+	failed_ = false;
+
+	writable_ = false;
+	loop_->addFdEvent(fd_, EventLoop::Read, [this]() { handleEvent(); });
+
+	return 0;
+}
+
+/*
+ * Send the frames still queued, if the socket accepts them, and release all
+ * the frames.
+ */
+void NetworkSink::stop()
+{
+	if (fd_ < 0)
+		return;
+
+	if (batch(tail_).count)
+		tail_++;
+
+	if (!failed_) {
+		flush();
+		loop_->removeFdEvent(fd_);
+	}
+
+	close(fd_);
+	fd_ = -1;
+
+	for (; head_ != tail_; ++head_)
+		release(batch(head_));
+
+	std::cout << address_ << ": sent " << frames_ << " frames, "
+		  << bytes_ / 1000000 << " MB";
+	if (zerocopy_ && copied_)
+		std::cout << ", " << copied_ << " sends copied by the kernel";
+	std::cout << std::endl;
+}
+
+void NetworkSink::processFrame(Frame *frame)
+{
+	if (fd_ < 0 || failed_ ||
+	    frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	Batch &current = batch(tail_);
+	const FrameRecord &record = frame->record();
+	FrameHeader &header = current.headers[current.count];
+
+	memcpy(header.magic, kMagic, sizeof(header.magic));
+	header.camera = record.camera;
+	header.stream = record.stream;
+	header.sequence = record.sequence;
+	header.timestamp = record.timestamp;
+	header.numPlanes = std::min<unsigned int>(record.numPlanes,
+						  frame->image().numPlanes());
+
+	size_t size = sizeof(header);
+	for (unsigned int i = 0; i < header.numPlanes; ++i) {
+		header.bytesused[i] = std::min<size_t>(record.bytesused[i],
+						       frame->image().data(i).size());
+		size += header.bytesused[i];
+	}
+
+	frame->acquire();
+	current.frames[current.count++] = frame;
+	current.size += size;
+	heldFrames_++;
+
+	/*
+	 * Keep filling the batch while the previous ones wait for the socket,
+	 * until it is large enough or holds all the frames the sink may hold.
+	 */
+	bool busy = writable_ || send_ != tail_;
+	if (busy && current.count < kMaxBatchFrames && current.size < kBatchSize &&
+	    heldFrames_ < queueSize_)
+		return;
+
+	batch(++tail_) = {};
+	flush();
+}
+
+void NetworkSink::handleEvent()
+{
+	if (zerocopy_)
+		complete();
+
+	/* The collector isn't expected to send anything but a disconnection. */
+	char data[64];
+	ssize_t ret = recv(fd_, data, sizeof(data), MSG_DONTWAIT);
+	if (!ret || (ret < 0 && errno != EAGAIN && errno != EINTR)) {
+		std::cerr << address_ << ": connection closed" << std::endl;
+		disconnect();
+		return;
+	}
+
+	flush();
+}
+
+/* Watch the socket for writability only while sends are blocked. */
+void NetworkSink::watch(bool writable)
+{
+	if (writable == writable_)
+		return;
+
+	writable_ = writable;
+
+	EventLoop::EventType type = writable
+				  ? static_cast<EventLoop::EventType>(EventLoop::Read | EventLoop::Write)
+				  : EventLoop::Read;
+
+	loop_->setFdEventType(fd_, type);
+}
+
+/*
+ * Send the queued batches, and then the batch being filled, as long as the
+ * socket accepts them.
+ */
+void NetworkSink::flush()
+{
+	for (;;) {
+		if (send_ == tail_) {
+			if (!batch(tail_).count)
+				break;
+
+			batch(++tail_) = {};
+		}
+
+		Batch &b = batch(send_);
+
+		ssize_t ret = send(b);
+		if (ret < 0) {
+			if (errno == EAGAIN) {
+				watch(true);
+				return;
+			}
+
+			std::cerr << address_ << ": send failed: "
+				  << strerror(errno) << std::endl;
+			disconnect();
+			return;
+		}
+
+		b.sent += ret;
+		bytes_ += ret;
+
+		if (zerocopy_)
+			b.lastId = nextId_++;
+
+		if (b.sent < b.size)
+			continue;
+
+		frames_ += b.count;
+		send_++;
+
+		/* Without zero-copy the data has been copied by the kernel. */
+		if (!zerocopy_)
+			release(batch(head_++));
+	}
+
+	watch(false);
+}
+
+/* Send the remainder of a batch with a single scatter-gather call. */
+ssize_t NetworkSink::send(Batch &b)
+{
+	struct iovec iov[kMaxBatchFrames * (1 + FrameRecord::kMaxPlanes)];
+	unsigned int count = 0;
+	size_t skip = b.sent;
+
+	auto add = [&](const void *data, size_t size) {
+		if (skip >= size) {
+			skip -= size;
+			return;
+		}
+
+		iov[count].iov_base = const_cast<uint8_t *>(static_cast<const uint8_t *>(data) + skip);
+		iov[count].iov_len = size - skip;
+		skip = 0;
+		count++;
+	};
+
+	for (unsigned int i = 0; i < b.count; ++i) {
+		const FrameHeader &header = b.headers[i];
+		const Image &image = b.frames[i]->image();
+
+		add(&header, sizeof(header));
+		for (unsigned int j = 0; j < header.numPlanes; ++j)
+			add(image.data(j).data(), header.bytesused[j]);
+	}
+
+	struct msghdr msg = {};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+	if (zerocopy_)
+		flags |= MSG_ZEROCOPY;
+
+	ssize_t ret;
+	do {
+		ret = sendmsg(fd_, &msg, flags);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret;
+}
+
+/*
+ * Read the zero-copy completion notifications from the socket error queue.
+ * Each notification reports a range of completed send IDs. TCP completes
+ * sends in order, the batches are released up to the last completed ID.
+ */
+void NetworkSink::complete()
+{
+	for (;;) {
+		char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+		struct msghdr msg = {};
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+			    !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+				continue;
+
+			const struct sock_extended_err *err =
+				reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+			if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				copied_++;
+
+			completedId_ = err->ee_data + 1;
+		}
+	}
+
+	while (head_ != send_ &&
+	       static_cast<int32_t>(batch(head_).lastId - completedId_) < 0)
+		release(batch(head_++));
+}
+
+/*
+ * Stop streaming when the connection fails, and release all the frames to
+ * keep the capture running.
+ */
+void NetworkSink::disconnect()
+{
+	failed_ = true;
+	loop_->removeFdEvent(fd_);
+
+	if (batch(tail_).count)
+		tail_++;
+
+	for (; head_ != tail_; ++head_)
+		release(batch(head_));
+
+	send_ = tail_;
+}
+
+void NetworkSink::release(Batch &b)
+{
+	for (unsigned int i = 0; i < b.count; ++i)
+		b.frames[i]->release();
+
+	heldFrames_ -= b.count;
+	b.count = 0;
+}
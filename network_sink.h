@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * network_sink.h - Frame sink streaming frames over TCP
+ */
+#ifndef __SIMPLE_CAM_NETWORK_SINK_H__
+#define __SIMPLE_CAM_NETWORK_SINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "event_loop.h"
+#include "frame_sink.h"
+
+/*
+ * The NetworkSink streams frames to a TCP collector. Each frame is sent as a
+ * FrameHeader followed by the data of its planes.
+ *
+ * Frames are sent straight from the buffer mappings with scatter-gather
+ * sendmsg() calls and MSG_ZEROCOPY, without copying them. The kernel reads
+ * the image data while transmitting it, so frames are held until the kernel
+ * reports that the transmission has completed, and only then released. This
+ * applies back-pressure to the camera when the network can't keep up,
+ * instead of dropping frames.
+ *
+ * Small frames are grouped in batches, sent with a single system call, while
+ * the socket is busy sending the previous ones. A batch is sent right away
+ * when the socket is idle, or when it holds all the frames the sink may hold,
+ * so that the camera never runs out of buffers waiting for a batch to fill.
+ */
+class NetworkSink : public FrameSink
+{
+public:
+	struct FrameHeader {
+		char magic[4];
+		uint32_t camera;
+		uint32_t stream;
+		uint32_t sequence;
+		uint64_t timestamp;
+		uint32_t numPlanes;
+		uint32_t bytesused[FrameRecord::kMaxPlanes];
+	};
+
+	/* The queue size is the maximum number of frames held at once. */
+	NetworkSink(EventLoop *loop, const std::string &address,
+		    size_t queueSize);
+	~NetworkSink();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+	bool failed() const override { return failed_; }
+
+private:
+	static constexpr unsigned int kMaxBatchFrames = 8;
+	static constexpr size_t kBatchSize = 256 * 1024;
+
+	struct Batch {
+		Frame *frames[kMaxBatchFrames];
+		FrameHeader headers[kMaxBatchFrames];
+		unsigned int count;
+		size_t size;
+		size_t sent;
+		/* ID of the last zero-copy send of the batch. */
+		uint32_t lastId;
+	};
+
+	Batch &batch(size_t index) { return batches_[index % batches_.size()]; }
+
+	void handleEvent();
+	void watch(bool writable);
+
+	void flush();
+	ssize_t send(Batch &batch);
+	void complete();
+	void release(Batch &batch);
+	void disconnect();
+
+	EventLoop *loop_;
+	std::string address_;
+	size_t queueSize_;
+	int fd_;
+	bool zerocopy_;
+	bool writable_;
+
+	/*
+	 * Ring of batches. Batches before send_ have been sent and wait for
+	 * their transmission to complete, batches from send_ to tail_ are
+	 * waiting to be sent, and the last one is still being filled.
+	 */
+	std::vector<Batch> batches_;
+	size_t head_;
+	size_t send_;
+	size_t tail_;
+	/* Number of frames held, in all the batches. */
+	size_t heldFrames_;
+
+	uint32_t nextId_;
+	uint32_t completedId_;
+
+	uint64_t frames_;
+	uint64_t bytes_;
+	uint64_t copied_;
+	bool failed_;
+};
+
+#endif /* __SIMPLE_CAM_NETWORK_SINK_H__ */
@@ -0,0 +1,159 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * numa.cpp - NUMA topology and memory placement helpers
+ *
+ * The memory policy system calls are used directly, to avoid depending on
+ * libnuma.
+ */
+
+#include "numa.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+/* Maximum number of pages sampled to find the node of a memory range. */
+constexpr size_t kMaxSampledPages = 64;
+
+/* Parse a sysfs list of ranges, such as "0-3,8-11". */
+std::vector<unsigned int> readList(const std::string &path)
+{
+	std::vector<unsigned int> list;
+	std::ifstream file(path);
+	std::string line;
+
+	if (!std::getline(file, line))
+		return list;
+
+	const char *str = line.c_str();
+
+	while (*str) {
+		char *end;
+		unsigned long first = strtoul(str, &end, 10);
+		if (end == str)
+			break;
+
+		unsigned long last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtoul(str, &end, 10);
+			if (end == str)
+				break;
+		}
+
+		for (unsigned long value = first; value <= last; ++value)
+			list.push_back(value);
+
+		if (*end != ',')
+			break;
+		str = end + 1;
+	}
+
+	return list;
+}
+
+} /* namespace */
+
+/* Return the online NUMA nodes, or an empty list if NUMA isn't supported. */
+std::vector<unsigned int> numaNodes()
+{
+	return readList("/sys/devices/system/node/online");
+}
+
+/* Return the CPUs of a NUMA node. */
+std::vector<unsigned int> numaNodeCpus(unsigned int node)
+{
+	return readList("/sys/devices/system/node/node" + std::to_string(node)
+			+ "/cpulist");
+}
+
+/* Return the NUMA node the calling thread is running on. */
+int numaCurrentNode()
+{
+	unsigned int cpu;
+	unsigned int node;
+
+	if (getcpu(&cpu, &node) < 0)
+		return -errno;
+
+	return node;
+}
+
+/*
+ * Set the preferred node of a memory range, and migrate the pages already
+ * allocated elsewhere. The address must be page-aligned.
+ *
+ * Only pages managed by the kernel memory allocator can be migrated. The
+ * pages of device buffers stay where the driver allocated them, which is
+ * usually the node of the device already.
+ */
+int numaBindMemory(void *address, size_t length, unsigned int node)
+{
+	constexpr unsigned int kBits = sizeof(unsigned long) * 8;
+	std::vector<unsigned long> mask(node / kBits + 1);
+	mask[node / kBits] = 1UL << (node % kBits);
+
+	/* The kernel ignores the last bit of the mask. */
+	int ret = syscall(SYS_mbind, address, length, MPOL_PREFERRED,
+			  mask.data(), mask.size() * kBits + 1, MPOL_MF_MOVE);
+
+	return ret < 0 ? -errno : 0;
+}
+
+/*
+ * Return the NUMA node most of the pages of a memory range are on, sampling
+ * them evenly, or a negative error code if it can't be determined. The
+ * address must be page-aligned.
+ */
+int numaMemoryNode(const void *address, size_t length)
+{
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t numPages = (length + pageSize - 1) / pageSize;
+	const size_t count = std::min(numPages, kMaxSampledPages);
+
+	if (!count)
+		return -EINVAL;
+
+	std::vector<void *> pages(count);
+	std::vector<int> status(count);
+
+	/* Only resident pages have a node, fault them in first. */
+	for (size_t i = 0; i < count; ++i) {
+		const volatile uint8_t *page = static_cast<const uint8_t *>(address)
+					     + i * numPages / count * pageSize;
+		(void)*page;
+
+		pages[i] = const_cast<uint8_t *>(page);
+	}
+
+	/* Without target nodes, move_pages() reports the node of each page. */
+	int ret = syscall(SYS_move_pages, 0, count, pages.data(), nullptr,
+			  status.data(), 0);
+	if (ret < 0)
+		return -errno;
+
+	std::vector<unsigned int> nodes;
+	for (int node : status) {
+		if (node < 0)
+			continue;
+		if (static_cast<size_t>(node) >= nodes.size())
+			nodes.resize(node + 1);
+		nodes[node]++;
+	}
+
+	if (nodes.empty())
+		return -ENOENT;
+
+	return std::max_element(nodes.begin(), nodes.end()) - nodes.begin();
+}
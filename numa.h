@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * numa.h - NUMA topology and memory placement helpers
+ */
+#ifndef __SIMPLE_CAM_NUMA_H__
+#define __SIMPLE_CAM_NUMA_H__
+
+#include <stddef.h>
+#include <vector>
+
+std::vector<unsigned int> numaNodes();
+std::vector<unsigned int> numaNodeCpus(unsigned int node);
+int numaCurrentNode();
+
+int numaBindMemory(void *address, size_t length, unsigned int node);
+int numaMemoryNode(const void *address, size_t length);
+
+#endif /* __SIMPLE_CAM_NUMA_H__ */
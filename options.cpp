@@ -0,0 +1,615 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * options.cpp - Command line options parsing
+ */
+
+#include "options.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <errno.h>
+#include <getopt.h>
+#include <iostream>
+#include <iterator>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+enum {
+	OptAll = 'a',
+	OptBenchmark = 'b',
+	OptCamera = 'c',
+	OptDuration = 'd',
+	OptHelp = 'h',
+	OptPipelined = 'p',
+	OptStream = 's',
+	OptThreaded = 't',
+	/* Long-only options */
+	OptBuffers = 256,
+	OptCodec,
+	OptConvert,
+	OptCountAllocations,
+	OptCpus,
+	OptDropPolicy,
+	OptDumpLog,
+	OptDumpRecording,
+	OptEncode,
+	OptEncoder,
+	OptExport,
+	OptFastStart,
+	OptGpu,
+	OptLog,
+	OptLoopCpus,
+	OptMaxBacklog,
+	OptMetrics,
+	OptMlock,
+	OptNuma,
+	OptRecord,
+	OptRecordSlots,
+	OptReplay,
+	OptReplayFast,
+	OptRequests,
+	OptRtPriority,
+	OptSave,
+	OptSend,
+	OptStatsInterval,
+	OptTrace,
+	OptWarmup,
+	OptWatchdog,
+	OptWorkers,
+};
+
+const struct option longOptions[] = {
+	{ "all", no_argument, nullptr, OptAll },
+	{ "benchmark", no_argument, nullptr, OptBenchmark },
+	{ "buffers", required_argument, nullptr, OptBuffers },
+	{ "camera", required_argument, nullptr, OptCamera },
+	{ "codec", required_argument, nullptr, OptCodec },
+	{ "convert", required_argument, nullptr, OptConvert },
+	{ "count-allocations", no_argument, nullptr, OptCountAllocations },
+	{ "cpus", required_argument, nullptr, OptCpus },
+	{ "drop-policy", required_argument, nullptr, OptDropPolicy },
+	{ "dump-log", required_argument, nullptr, OptDumpLog },
+	{ "dump-recording", required_argument, nullptr, OptDumpRecording },
+	{ "duration", required_argument, nullptr, OptDuration },
+	{ "encode", required_argument, nullptr, OptEncode },
+	{ "encoder", required_argument, nullptr, OptEncoder },
+	{ "export", required_argument, nullptr, OptExport },
+	{ "fast-start", no_argument, nullptr, OptFastStart },
+	{ "gpu", no_argument, nullptr, OptGpu },
+	{ "help", no_argument, nullptr, OptHelp },
+	{ "log", required_argument, nullptr, OptLog },
+	{ "loop-cpus", required_argument, nullptr, OptLoopCpus },
+	{ "max-backlog", required_argument, nullptr, OptMaxBacklog },
+	{ "metrics", required_argument, nullptr, OptMetrics },
+	{ "mlock", no_argument, nullptr, OptMlock },
+	{ "numa", required_argument, nullptr, OptNuma },
+	{ "pipelined", no_argument, nullptr, OptPipelined },
+	{ "record", required_argument, nullptr, OptRecord },
+	{ "record-slots", required_argument, nullptr, OptRecordSlots },
+	{ "replay", required_argument, nullptr, OptReplay },
+	{ "replay-fast", no_argument, nullptr, OptReplayFast },
+	{ "requests", required_argument, nullptr, OptRequests },
+	{ "rt-priority", required_argument, nullptr, OptRtPriority },
+	{ "save", required_argument, nullptr, OptSave },
+	{ "send", required_argument, nullptr, OptSend },
+	{ "stats-interval", required_argument, nullptr, OptStatsInterval },
+	{ "stream", required_argument, nullptr, OptStream },
+	{ "threaded", no_argument, nullptr, OptThreaded },
+	{ "trace", required_argument, nullptr, OptTrace },
+	{ "warmup", required_argument, nullptr, OptWarmup },
+	{ "watchdog", required_argument, nullptr, OptWatchdog },
+	{ "workers", required_argument, nullptr, OptWorkers },
+	{ nullptr, 0, nullptr, 0 },
+};
+
+void usage(const char *argv0)
+{
+	std::cout
+		<< "Usage: " << argv0 << " [options]" << std::endl
+		<< std::endl
+		<< "Options:" << std::endl
+		<< "  -a, --all               Capture from all cameras" << std::endl
+		<< "  -b, --benchmark         Report a throughput summary instead of frame details" << std::endl
+		<< "      --buffers=N         Allocate N buffers per stream" << std::endl
+		<< "  -c, --camera=CAMERA     Capture from CAMERA, by index or ID (repeatable)" << std::endl
+		<< "      --codec=CODEC       Encode to CODEC, h264 (default) or mjpeg" << std::endl
+		<< "      --convert=STREAM:FORMAT" << std::endl
+		<< "                          Convert frames of stream index STREAM to FORMAT" << std::endl
+		<< "                          (RGB888, XRGB8888 or R8) (repeatable)" << std::endl
+		<< "      --count-allocations Count the heap allocations of the frame path, and" << std::endl
+		<< "                          fail if there are any" << std::endl
+		<< "      --cpus=CPU[,CPU...] Pin the thread of each camera to a CPU (implies -t)" << std::endl
+		<< "      --drop-policy=POLICY" << std::endl
+		<< "                          Drop requests when the consumers are overloaded:" << std::endl
+		<< "                          oldest, newest or skip:N (one request out of N)" << std::endl
+		<< "  -d, --duration=S        Capture for S seconds (default 3)" << std::endl
+		<< "      --dump-log=FILE     Print the frame records of a binary log FILE and exit" << std::endl
+		<< "      --dump-recording=FILE[:TIMESTAMP]" << std::endl
+		<< "                          Print the index of a recording FILE, from TIMESTAMP" << std::endl
+		<< "                          (in nanoseconds) onwards, and exit" << std::endl
+		<< "      --encode=DIR        Encode the streams of each camera to files in DIR" << std::endl
+		<< "      --encoder=DEVICE    Encode with the V4L2 encoder DEVICE (default: first" << std::endl
+		<< "                          encoder supporting the codec)" << std::endl
+		<< "      --export=DIR        Share the frames of each camera with other processes" << std::endl
+		<< "                          through a UNIX socket in DIR" << std::endl
+		<< "      --fast-start        Set up and start the cameras concurrently" << std::endl
+		<< "      --gpu               Import the frames to the GPU as OpenGL ES textures" << std::endl
+		<< "  -h, --help              Display this help message" << std::endl
+		<< "      --log=FILE          Write binary frame records to FILE" << std::endl
+		<< "      --loop-cpus=CPU[,CPU...]" << std::endl
+		<< "                          Pin the application event loop thread to CPUs" << std::endl
+		<< "      --max-backlog=N     Consumers are overloaded with N requests waiting or" << std::endl
+		<< "                          frames held (default 2)" << std::endl
+		<< "      --metrics=[HOST:]PORT" << std::endl
+		<< "                          Serve live metrics in the Prometheus format over" << std::endl
+		<< "                          HTTP on PORT" << std::endl
+		<< "      --mlock             Lock the buffer mappings in memory" << std::endl
+		<< "      --numa=auto|NODE[,NODE...]" << std::endl
+		<< "                          Place the buffers and threads of each camera on a" << std::endl
+		<< "                          NUMA node, or on the node of its buffers (auto)" << std::endl
+		<< "  -p, --pipelined         Re-queue requests before consuming frames" << std::endl
+		<< "      --record=DIR        Record the last frames of each camera to a file in DIR" << std::endl
+		<< "      --record-slots=N    Record the last N frames (default 64)" << std::endl
+		<< "      --replay=FILE       Feed the frames of a trace FILE to the consumers" << std::endl
+		<< "                          instead of capturing from a camera" << std::endl
+		<< "      --replay-fast       Replay as fast as possible instead of at the" << std::endl
+		<< "                          original frame timing" << std::endl
+		<< "      --requests=N        Queue N requests to the camera" << std::endl
+		<< "      --rt-priority=N     Run the event loop threads with SCHED_FIFO priority N" << std::endl
+		<< "      --save=DIR          Write the captured frames to files in DIR" << std::endl
+		<< "      --send=HOST:PORT    Stream the frames to a TCP collector" << std::endl
+		<< "      --stats-interval=S  Print frame statistics every S seconds" << std::endl
+		<< "  -s, --stream=ROLE[:WxH[:FORMAT]]" << std::endl
+		<< "                          Capture a stream for ROLE (viewfinder, video, still" << std::endl
+		<< "                          or raw), optionally with a size and pixel format" << std::endl
+		<< "                          (repeatable)" << std::endl
+		<< "  -t, --threaded          Handle each camera in its own thread" << std::endl
+		<< "      --trace=DIR         Trace all the frames of each camera to a file in DIR," << std::endl
+		<< "                          for replay" << std::endl
+		<< "      --warmup=N          Exclude the first N frames from statistics" << std::endl
+		<< "      --watchdog=N        Restart the camera when no frame completes for N" << std::endl
+		<< "                          frame intervals" << std::endl
+		<< "      --workers=N         Process frames in parallel on N worker threads" << std::endl;
+}
+
+/*
+ * Parse the decimal number at the start of the string. strtoul() accepts
+ * leading white space and signs, and negates negative numbers, so the number
+ * must start with a digit.
+ */
+int parseDecimal(const char *str, char **end, unsigned int *value)
+{
+	if (!isdigit(static_cast<unsigned char>(*str)))
+		return -1;
+
+	errno = 0;
+	unsigned long result = strtoul(str, end, 10);
+	if (errno == ERANGE || result > UINT_MAX)
+		return -1;
+
+	*value = result;
+	return 0;
+}
+
+int parseUInt(const char *arg, unsigned int *value)
+{
+	unsigned int result;
+	char *end;
+
+	if (parseDecimal(arg, &end, &result) < 0 || *end || !result)
+		return -1;
+
+	*value = result;
+	return 0;
+}
+
+/* Parse a comma-separated list of numbers, without empty items. */
+int parseUIntList(const char *arg, std::vector<unsigned int> *list)
+{
+	const char *str = arg;
+
+	for (;;) {
+		unsigned int value;
+		char *end;
+
+		if (parseDecimal(str, &end, &value) < 0)
+			return -1;
+
+		list->push_back(value);
+
+		if (!*end)
+			return 0;
+		if (*end != ',')
+			return -1;
+
+		str = end + 1;
+	}
+}
+
+/* CPU numbers must fit in a cpu_set_t to set the thread affinity. */
+int parseCpuList(const char *arg, std::vector<unsigned int> *list)
+{
+	if (parseUIntList(arg, list) < 0)
+		return -1;
+
+	for (unsigned int cpu : *list) {
+		if (cpu >= CPU_SETSIZE)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Parse a stream description as ROLE[:WxH[:FORMAT]]. */
+int parseStream(const std::string &arg, StreamOptions *stream)
+{
+	static const struct {
+		const char *name;
+		libcamera::StreamRole role;
+	} roles[] = {
+		{ "raw", libcamera::StreamRole::Raw },
+		{ "still", libcamera::StreamRole::StillCapture },
+		{ "video", libcamera::StreamRole::VideoRecording },
+		{ "viewfinder", libcamera::StreamRole::Viewfinder },
+	};
+
+	size_t pos = arg.find(':');
+	std::string role = arg.substr(0, pos);
+
+	auto iter = std::find_if(std::begin(roles), std::end(roles),
+				 [&](const auto &r) { return role == r.name; });
+	if (iter == std::end(roles))
+		return -1;
+
+	stream->role = iter->role;
+
+	if (pos == std::string::npos)
+		return 0;
+
+	std::string size = arg.substr(pos + 1);
+	pos = size.find(':');
+
+	if (pos != std::string::npos) {
+		stream->format = libcamera::PixelFormat::fromString(size.substr(pos + 1));
+		if (!stream->format.isValid())
+			return -1;
+
+		size = size.substr(0, pos);
+	}
+
+	if (sscanf(size.c_str(), "%ux%u", &stream->width, &stream->height) != 2)
+		return -1;
+
+	return 0;
+}
+
+/* Parse a drop policy as oldest, newest or skip:N. */
+int parseDropPolicy(const std::string &arg, Options *options)
+{
+	if (arg == "oldest") {
+		options->dropMode = DropMode::DropOldest;
+		return 0;
+	}
+
+	if (arg == "newest") {
+		options->dropMode = DropMode::DropNewest;
+		return 0;
+	}
+
+	if (arg.compare(0, 5, "skip:"))
+		return -1;
+
+	options->dropMode = DropMode::Skip;
+	return parseUInt(arg.c_str() + 5, &options->skipInterval);
+}
+
+/* Parse a conversion description as STREAM:FORMAT. */
+int parseConvert(const std::string &arg, ConvertOptions *convert)
+{
+	unsigned int stream;
+	char *end;
+
+	if (parseDecimal(arg.c_str(), &end, &stream) < 0 || *end != ':')
+		return -1;
+
+	convert->stream = stream;
+	convert->format = libcamera::PixelFormat::fromString(end + 1);
+	if (!convert->format.isValid())
+		return -1;
+
+	return 0;
+}
+
+} /* namespace */
+
+int parseOptions(int argc, char *argv[], Options *options)
+{
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, "abc:d:hps:t", longOptions, nullptr)) != -1) {
+		switch (opt) {
+		case OptAll:
+			options->allCameras = true;
+			break;
+
+		case OptBenchmark:
+			options->benchmark = true;
+			break;
+
+		case OptBuffers:
+			if (parseUInt(optarg, &options->buffers) < 0) {
+				std::cerr << "Invalid buffer count '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptCamera:
+			options->cameras.push_back(optarg);
+			break;
+
+		case OptCodec:
+			if (!strcmp(optarg, "h264")) {
+				options->encodeCodec = EncoderCodec::H264;
+			} else if (!strcmp(optarg, "mjpeg")) {
+				options->encodeCodec = EncoderCodec::MJPEG;
+			} else {
+				std::cerr << "Invalid codec '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptConvert: {
+			ConvertOptions convert;
+			if (parseConvert(optarg, &convert) < 0) {
+				std::cerr << "Invalid conversion '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			options->converts.push_back(convert);
+			break;
+		}
+
+		case OptCountAllocations:
+			options->countAllocations = true;
+			break;
+
+		case OptCpus:
+			if (parseCpuList(optarg, &options->cpus) < 0) {
+				std::cerr << "Invalid CPU list '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			options->threaded = true;
+			break;
+
+		case OptDuration:
+			if (parseUInt(optarg, &options->duration) < 0) {
+				std::cerr << "Invalid duration '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptDropPolicy:
+			if (parseDropPolicy(optarg, options) < 0) {
+				std::cerr << "Invalid drop policy '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptDumpLog:
+			options->dumpLog = optarg;
+			break;
+
+		case OptDumpRecording: {
+			std::string arg = optarg;
+			size_t pos = arg.rfind(':');
+			if (pos != std::string::npos) {
+				const char *timestamp = optarg + pos + 1;
+				char *end;
+				errno = 0;
+				options->dumpTimestamp = strtoull(timestamp, &end, 10);
+				if (!isdigit(static_cast<unsigned char>(*timestamp)) ||
+				    errno == ERANGE || *end) {
+					std::cerr << "Invalid timestamp '" << timestamp
+						  << "'" << std::endl;
+					return -1;
+				}
+				arg = arg.substr(0, pos);
+			}
+			options->dumpRecording = arg;
+			break;
+		}
+
+		case OptEncode:
+			options->encodeDir = optarg;
+			break;
+
+		case OptEncoder:
+			options->encoderDevice = optarg;
+			break;
+
+		case OptExport:
+			options->exportDir = optarg;
+			break;
+
+		case OptFastStart:
+			options->fastStart = true;
+			break;
+
+		case OptGpu:
+			options->gpu = true;
+			break;
+
+		case OptHelp:
+			usage(argv[0]);
+			return 1;
+
+		case OptLog:
+			options->logFile = optarg;
+			break;
+
+		case OptLoopCpus:
+			if (parseCpuList(optarg, &options->loopCpus) < 0) {
+				std::cerr << "Invalid CPU list '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptMaxBacklog:
+			if (parseUInt(optarg, &options->maxBacklog) < 0) {
+				std::cerr << "Invalid backlog '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptMetrics:
+			options->metricsAddress = optarg;
+			break;
+
+		case OptMlock:
+			options->lockBuffers = true;
+			break;
+
+		case OptNuma:
+			options->numa = true;
+			if (strcmp(optarg, "auto") &&
+			    parseUIntList(optarg, &options->numaNodes) < 0) {
+				std::cerr << "Invalid NUMA node list '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptPipelined:
+			options->pipelined = true;
+			break;
+
+		case OptRecord:
+			options->recordDir = optarg;
+			break;
+
+		case OptRecordSlots:
+			if (parseUInt(optarg, &options->recordSlots) < 0) {
+				std::cerr << "Invalid slot count '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptReplay:
+			options->replay = optarg;
+			break;
+
+		case OptReplayFast:
+			options->replayFast = true;
+			break;
+
+		case OptRequests:
+			if (parseUInt(optarg, &options->requests) < 0) {
+				std::cerr << "Invalid request count '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptRtPriority:
+			if (parseUInt(optarg, &options->rtPriority) < 0 ||
+			    options->rtPriority > 99) {
+				std::cerr << "Invalid real-time priority '" << optarg
+					  << "'" << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptSave:
+			options->saveDir = optarg;
+			break;
+
+		case OptSend:
+			options->sendAddress = optarg;
+			break;
+
+		case OptStatsInterval:
+			if (parseUInt(optarg, &options->statsInterval) < 0) {
+				std::cerr << "Invalid statistics interval '" << optarg
+					  << "'" << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptStream: {
+			StreamOptions stream;
+			if (parseStream(optarg, &stream) < 0) {
+				std::cerr << "Invalid stream '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			options->streams.push_back(stream);
+			break;
+		}
+
+		case OptThreaded:
+			options->threaded = true;
+			break;
+
+		case OptTrace:
+			options->traceDir = optarg;
+			break;
+
+		case OptWarmup: {
+			unsigned int warmup;
+			char *end;
+
+			if (parseDecimal(optarg, &end, &warmup) < 0 || *end ||
+			    warmup > INT_MAX) {
+				std::cerr << "Invalid warmup '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			options->warmup = warmup;
+			break;
+		}
+
+		case OptWatchdog:
+			if (parseUInt(optarg, &options->watchdog) < 0) {
+				std::cerr << "Invalid watchdog interval count '"
+					  << optarg << "'" << std::endl;
+				return -1;
+			}
+			break;
+
+		case OptWorkers:
+			if (parseUInt(optarg, &options->workers) < 0) {
+				std::cerr << "Invalid worker count '" << optarg << "'"
+					  << std::endl;
+				return -1;
+			}
+			break;
+
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (optind < argc) {
+		std::cerr << "Unexpected argument '" << argv[optind] << "'"
+			  << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
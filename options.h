@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * options.h - Command line options parsing
+ */
+#ifndef __SIMPLE_CAM_OPTIONS_H__
+#define __SIMPLE_CAM_OPTIONS_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/pixel_format.h>
+#include <libcamera/stream.h>
+
+struct StreamOptions {
+	libcamera::StreamRole role = libcamera::StreamRole::Viewfinder;
+	/* Zero width and height, or an invalid format, keep the defaults. */
+	unsigned int width = 0;
+	unsigned int height = 0;
+	libcamera::PixelFormat format;
+};
+
+enum class DropMode {
+	None,
+	DropOldest,
+	DropNewest,
+	Skip,
+};
+
+enum class EncoderCodec {
+	H264,
+	MJPEG,
+};
+
+struct ConvertOptions {
+	/* Index of the stream to convert, in the order of the --stream options. */
+	unsigned int stream = 0;
+	libcamera::PixelFormat format;
+};
+
+struct Options {
+	/* Cameras to capture from, by index or ID. Empty selects the first. */
+	std::vector<std::string> cameras;
+	bool allCameras = false;
+
+	/* Streams to capture from each camera. Empty selects a viewfinder. */
+	std::vector<StreamOptions> streams;
+	/* Pixel format conversions applied to captured streams. */
+	std::vector<ConvertOptions> converts;
+
+	/* Configure and start the cameras concurrently. */
+	bool fastStart = false;
+
+	/* Run each camera on its own thread with its own event loop. */
+	bool threaded = false;
+	/* CPUs to pin the camera threads to, one per camera, in order. */
+	std::vector<unsigned int> cpus;
+	/* CPUs to pin the application event loop thread to. */
+	std::vector<unsigned int> loopCpus;
+	/*
+	 * SCHED_FIFO priority of the event loop threads, zero for the default
+	 * scheduling policy.
+	 */
+	unsigned int rtPriority = 0;
+	/* Lock the buffer mappings in memory. */
+	bool lockBuffers = false;
+	/*
+	 * Place the buffers, camera threads and workers of each camera on a
+	 * NUMA node, one per camera, in order. Cameras without a node use the
+	 * node their buffers were allocated on, normally the closest to the
+	 * device.
+	 */
+	bool numa = false;
+	std::vector<unsigned int> numaNodes;
+
+	/*
+	 * Number of worker threads processing frames in parallel, shared by
+	 * all cameras. Zero processes frames in the camera threads.
+	 */
+	unsigned int workers = 0;
+
+	/*
+	 * Re-queue requests with spare buffers as soon as they complete, and
+	 * hand the captured buffers to the consumers separately.
+	 */
+	bool pipelined = false;
+
+	/*
+	 * Number of buffers to allocate per stream, and number of requests to
+	 * create. Zero selects the camera default and one request per buffer
+	 * (minus one spare buffer in pipelined mode).
+	 */
+	unsigned int buffers = 0;
+	unsigned int requests = 0;
+
+	/*
+	 * Requests dropped when the consumers are overloaded, that is when
+	 * maxBacklog completed requests are waiting, or frames held. The skip
+	 * mode hands one request out of skipInterval to the consumers.
+	 */
+	DropMode dropMode = DropMode::None;
+	unsigned int skipInterval = 2;
+	unsigned int maxBacklog = 2;
+
+	/*
+	 * Restart the camera when no frame completes for this number of frame
+	 * intervals. Zero disables the watchdog.
+	 */
+	unsigned int watchdog = 0;
+
+	/* Print frame statistics periodically, every interval seconds. */
+	unsigned int statsInterval = 0;
+
+	/* Capture duration in seconds. */
+	unsigned int duration = 3;
+	/*
+	 * Number of frames per stream excluded from the statistics. A negative
+	 * value selects the number of requests.
+	 */
+	int warmup = -1;
+	/* Skip per-frame output and report a benchmark summary. */
+	bool benchmark = false;
+	/*
+	 * Count the heap allocations made while processing frames, after the
+	 * warmup, and fail if there are any.
+	 */
+	bool countAllocations = false;
+
+	/* Write the captured frames to files in this directory. */
+	std::string saveDir;
+
+	/*
+	 * Encode the captured streams to files in this directory, with a V4L2
+	 * encoder device. An empty device selects the first suitable encoder.
+	 */
+	std::string encodeDir;
+	EncoderCodec encodeCodec = EncoderCodec::H264;
+	std::string encoderDevice;
+
+	/*
+	 * Import the frames to the GPU as OpenGL ES textures. This requires
+	 * simple-cam to be built with EGL support.
+	 */
+	bool gpu = false;
+
+	/* Share the frames with other processes through sockets in this directory. */
+	std::string exportDir;
+
+	/* Stream the frames to a TCP collector, as HOST:PORT. */
+	std::string sendAddress;
+
+	/* Record the last recordSlots frames of each camera in this directory. */
+	std::string recordDir;
+	unsigned int recordSlots = 64;
+	/* Print the index of a recording, from the timestamp onwards, and exit. */
+	std::string dumpRecording;
+	uint64_t dumpTimestamp = 0;
+
+	/* Trace all the frames of each camera to a file in this directory. */
+	std::string traceDir;
+	/*
+	 * Feed the frames of a trace to the consumers instead of capturing
+	 * from a camera, at the original frame timing, or as fast as the
+	 * consumers allow.
+	 */
+	std::string replay;
+	bool replayFast = false;
+
+	/* Serve live metrics over HTTP on this address, as [HOST:]PORT. */
+	std::string metricsAddress;
+
+	/* Write binary frame records to a file instead of text to stdout. */
+	std::string logFile;
+	/* Decode a binary frame log file and exit. */
+	std::string dumpLog;
+};
+
+int parseOptions(int argc, char *argv[], Options *options);
+
+#endif /* __SIMPLE_CAM_OPTIONS_H__ */
@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * recording.cpp - Memory mapped ring buffer recording files
+ */
+
+#include "recording.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace libcamera;
+using namespace recording;
+
+namespace {
+
+constexpr char kMagic[4] = { 'S', 'C', 'R', 'B' };
+constexpr uint32_t kVersion = 1;
+
+/* Slots are page aligned, for efficient access to the frame data. */
+constexpr size_t kAlignment = 4096;
+
+size_t alignUp(size_t value)
+{
+	return (value + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+} /* namespace */
+
+/* -----------------------------------------------------------------------------
+ * RecordingWriter
+ */
+
+RecordingWriter::RecordingWriter(const std::string &filename, size_t slotSize,
+				 unsigned int numSlots)
+	: filename_(filename), slotSize_(alignUp(slotSize)), numSlots_(numSlots),
+	  fd_(-1), map_(nullptr), mapSize_(0), header_(nullptr),
+	  index_(nullptr), data_(nullptr), truncated_(0)
+{
+}
+
+RecordingWriter::~RecordingWriter()
+{
+	stop();
+}
+
+/*
+ * The whole file is allocated and mapped when the recording starts, so that
+ * storing a frame never extends the file or faults in new file system
+ * blocks.
+ */
+int RecordingWriter::start()
+{
+	size_t dataOffset = alignUp(sizeof(Header) + numSlots_ * sizeof(FrameRecord));
+	mapSize_ = dataOffset + numSlots_ * slotSize_;
+
+	fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd_ < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to open " << filename_ << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	int ret = posix_fallocate(fd_, 0, mapSize_);
+	if (ret) {
+		std::cerr << "Failed to allocate " << mapSize_ << " bytes for "
+			  << filename_ << ": " << strerror(ret) << std::endl;
+		close(fd_);
+		fd_ = -1;
+		return -ret;
+	}
+
+	void *map = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 fd_, 0);
+	if (map == MAP_FAILED) {
+		ret = -errno;
+		std::cerr << "Failed to map " << filename_ << ": "
+			  << strerror(-ret) << std::endl;
+		close(fd_);
+		fd_ = -1;
+		return ret;
+	}
+
+	map_ = static_cast<uint8_t *>(map);
+	header_ = reinterpret_cast<Header *>(map_);
+	index_ = reinterpret_cast<FrameRecord *>(map_ + sizeof(Header));
+	data_ = map_ + dataOffset;
+
+	memcpy(header_->magic, kMagic, sizeof(header_->magic));
+	header_->version = kVersion;
+	header_->recordSize = sizeof(FrameRecord);
+	header_->numSlots = numSlots_;
+	header_->slotSize = slotSize_;
+	header_->dataOffset = dataOffset;
+	header_->count = 0;
+
+	truncated_ = 0;
+
+	return 0;
+}
+
+void RecordingWriter::stop()
+{
+	if (!map_)
+		return;
+
+	uint64_t count = header_->count;
+
+	msync(map_, mapSize_, MS_SYNC);
+	munmap(map_, mapSize_);
+	map_ = nullptr;
+
+	close(fd_);
+	fd_ = -1;
+
+	std::cout << filename_ << ": recorded "
+		  << std::min<uint64_t>(count, numSlots_) << " of " << count
+		  << " frames";
+	if (truncated_)
+		std::cout << ", truncated " << truncated_ << " frames";
+	std::cout << std::endl;
+}
+
+void RecordingWriter::processFrame(Frame *frame)
+{
+	if (frame->metadata().status != FrameMetadata::FrameSuccess)
+		return;
+
+	uint64_t count = header_->count;
+	unsigned int slot = count % numSlots_;
+	uint8_t *data = data_ + slot * slotSize_;
+	const Image &image = frame->image();
+
+	FrameRecord &record = index_[slot];
+	record = frame->record();
+	record.numPlanes = 0;
+
+	size_t offset = 0;
+	bool truncated = false;
+
+	for (unsigned int i = 0; i < image.numPlanes(); ++i) {
+		if (i == FrameRecord::kMaxPlanes)
+			break;
+
+		size_t size = std::min<size_t>(frame->metadata().planes()[i].bytesused,
+					       image.data(i).size());
+		if (size > slotSize_ - offset) {
+			size = slotSize_ - offset;
+			truncated = true;
+		}
+
+		memcpy(data + offset, image.data(i).data(), size);
+		record.bytesused[record.numPlanes++] = size;
+		offset += size;
+	}
+
+	if (truncated)
+		truncated_++;
+
+	/* Publish the frame to the readers once it has been fully stored. */
+	__atomic_store_n(&header_->count, count + 1, __ATOMIC_RELEASE);
+}
+
+/* -----------------------------------------------------------------------------
+ * RecordingReader
+ */
+
+std::unique_ptr<RecordingReader> RecordingReader::open(const std::string &filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		std::cerr << "Failed to open " << filename << ": "
+			  << strerror(errno) << std::endl;
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+		std::cerr << "Invalid recording " << filename << std::endl;
+		close(fd);
+		return nullptr;
+	}
+
+	void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		std::cerr << "Failed to map " << filename << ": "
+			  << strerror(errno) << std::endl;
+		return nullptr;
+	}
+
+	std::unique_ptr<RecordingReader> reader{ new RecordingReader() };
+	reader->map_ = static_cast<const uint8_t *>(map);
+	reader->mapSize_ = st.st_size;
+
+	const Header *header = reinterpret_cast<const Header *>(reader->map_);
+	if (memcmp(header->magic, kMagic, sizeof(kMagic)) ||
+	    header->version != kVersion ||
+	    header->recordSize != sizeof(FrameRecord) || !header->numSlots ||
+	    header->dataOffset < sizeof(Header) + header->numSlots * sizeof(FrameRecord) ||
+	    header->dataOffset > reader->mapSize_ ||
+	    header->slotSize > (reader->mapSize_ - header->dataOffset) / header->numSlots) {
+		std::cerr << "Invalid recording " << filename << std::endl;
+		return nullptr;
+	}
+
+	reader->header_ = header;
+	reader->index_ = reinterpret_cast<const FrameRecord *>(reader->map_ + sizeof(Header));
+	reader->data_ = reader->map_ + header->dataOffset;
+	uint64_t count = __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+	reader->size_ = std::min<uint64_t>(count, header->numSlots);
+	reader->first_ = count - reader->size_;
+
+	/* The planes of every frame must fit in its slot. */
+	for (size_t i = 0; i < reader->size_; ++i) {
+		const FrameRecord &record = reader->record(i);
+		bool valid = record.numPlanes <= FrameRecord::kMaxPlanes;
+		uint64_t bytes = 0;
+
+		for (unsigned int j = 0; valid && j < record.numPlanes; ++j)
+			bytes += record.bytesused[j];
+
+		if (!valid || bytes > header->slotSize) {
+			std::cerr << "Invalid recording " << filename << std::endl;
+			return nullptr;
+		}
+	}
+
+	return reader;
+}
+
+RecordingReader::~RecordingReader()
+{
+	if (map_)
+		munmap(const_cast<uint8_t *>(map_), mapSize_);
+}
+
+size_t RecordingReader::slot(size_t index) const
+{
+	return (first_ + index) % header_->numSlots;
+}
+
+const FrameRecord &RecordingReader::record(size_t index) const
+{
+	return index_[slot(index)];
+}
+
+Span<const uint8_t> RecordingReader::data(size_t index, unsigned int plane) const
+{
+	const FrameRecord &rec = record(index);
+	if (plane >= rec.numPlanes)
+		return {};
+
+	size_t offset = 0;
+	for (unsigned int i = 0; i < plane; ++i)
+		offset += rec.bytesused[i];
+
+	return { data_ + slot(index) * header_->slotSize + offset, rec.bytesused[plane] };
+}
+
+/*
+ * Return the index of the first frame captured at or after the timestamp, or
+ * size() if there is none. Frames are stored in capture order, the index is
+ * searched with a binary search.
+ */
+size_t RecordingReader::seek(uint64_t timestamp) const
+{
+	size_t low = 0;
+	size_t high = size_;
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (record(mid).timestamp < timestamp)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/*
+ * Print the index of a recording as text, starting at the first frame
+ * captured at or after the timestamp.
+ */
+int RecordingReader::dump(const std::string &filename, uint64_t timestamp,
+			  std::ostream &out)
+{
+	std::unique_ptr<RecordingReader> reader = open(filename);
+	if (!reader)
+		return -EINVAL;
+
+	for (size_t i = reader->seek(timestamp); i < reader->size(); ++i)
+		FrameLogger::format(reader->record(i), out);
+
+	return 0;
+}
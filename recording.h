@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * recording.h - Memory mapped ring buffer recording files
+ */
+#ifndef __SIMPLE_CAM_RECORDING_H__
+#define __SIMPLE_CAM_RECORDING_H__
+
+#include <memory>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include <libcamera/base/span.h>
+
+#include "frame_logger.h"
+#include "frame_sink.h"
+
+/*
+ * A recording is a preallocated file holding the last frames captured by a
+ * camera. It starts with a header, followed by an index of one FrameRecord
+ * per slot, and by the fixed size slots storing the frame data :
+ *
+ *   +--------+---------------------+--------+--------+-----+
+ *   | Header | Index (numSlots)    | Slot 0 | Slot 1 | ... |
+ *   +--------+---------------------+--------+--------+-----+
+ *
+ * Frames are stored in slots in a round-robin fashion, overwriting the oldest
+ * ones when the recording is full. The planes of a frame are stored
+ * contiguously in its slot, with their sizes recorded in the index.
+ *
+ * The file is accessed through a shared memory mapping by both the writer and
+ * the readers, without any copy beside the one from the frame buffers.
+ */
+namespace recording {
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t numSlots;
+	uint64_t slotSize;
+	uint64_t dataOffset;
+	/*
+	 * Total number of frames written, including the overwritten ones. It
+	 * is updated with a release store once a frame has been stored, and
+	 * must be read with an acquire load.
+	 */
+	uint64_t count;
+};
+
+} /* namespace recording */
+
+class RecordingWriter : public FrameSink
+{
+public:
+	RecordingWriter(const std::string &filename, size_t slotSize,
+			unsigned int numSlots);
+	~RecordingWriter();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+
+private:
+	std::string filename_;
+	size_t slotSize_;
+	unsigned int numSlots_;
+
+	int fd_;
+	uint8_t *map_;
+	size_t mapSize_;
+
+	recording::Header *header_;
+	FrameRecord *index_;
+	uint8_t *data_;
+
+	/* Frames larger than a slot, stored truncated. */
+	uint64_t truncated_;
+};
+
+class RecordingReader
+{
+public:
+	static std::unique_ptr<RecordingReader> open(const std::string &filename);
+	~RecordingReader();
+
+	/* Number of frames in the recording, ordered from the oldest. */
+	size_t size() const { return size_; }
+
+	const FrameRecord &record(size_t index) const;
+	libcamera::Span<const uint8_t> data(size_t index, unsigned int plane) const;
+
+	size_t seek(uint64_t timestamp) const;
+
+	static int dump(const std::string &filename, uint64_t timestamp,
+			std::ostream &out);
+
+private:
+	RecordingReader() = default;
+
+	size_t slot(size_t index) const;
+
+	const uint8_t *map_ = nullptr;
+	size_t mapSize_ = 0;
+
+	const recording::Header *header_;
+	const FrameRecord *index_;
+	const uint8_t *data_;
+	size_t first_;
+	size_t size_;
+};
+
+#endif /* __SIMPLE_CAM_RECORDING_H__ */
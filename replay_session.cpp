@@ -0,0 +1,483 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * replay_session.cpp - Replay of a capture trace to the frame consumers
+ */
+
+#include "replay_session.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <linux/udmabuf.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/geometry.h>
+#include <libcamera/pixel_format.h>
+
+#include "allocation_counter.h"
+#include "clock.h"
+
+using namespace libcamera;
+
+namespace {
+
+/* Number of buffers per stream, when not set on the command line. */
+constexpr unsigned int kDefaultBuffers = 4;
+
+/*
+ * Allocate the memory of a buffer, and return a file descriptor for it. The
+ * memfd is turned into a dmabuf with udmabuf when possible, for consumers
+ * that import the buffers in other devices. Consumers that only map the
+ * buffers work with the memfd as-is.
+ */
+int allocateBuffer(size_t size, bool *dmabuf)
+{
+	int memfd = memfd_create("simple-cam-replay", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (memfd < 0)
+		return -errno;
+
+	/* udmabuf requires the memfd to be sealed against shrinking. */
+	if (ftruncate(memfd, size) < 0 ||
+	    fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) < 0) {
+		int ret = -errno;
+		close(memfd);
+		return ret;
+	}
+
+	*dmabuf = false;
+
+	int device = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+	if (device < 0)
+		return memfd;
+
+	struct udmabuf_create create = {};
+	create.memfd = memfd;
+	create.flags = UDMABUF_FLAGS_CLOEXEC;
+	create.offset = 0;
+	create.size = size;
+
+	int fd = ioctl(device, UDMABUF_CREATE, &create);
+	close(device);
+
+	if (fd < 0)
+		return memfd;
+
+	close(memfd);
+	*dmabuf = true;
+
+	return fd;
+}
+
+} /* namespace */
+
+ReplaySession::ReplaySession(std::unique_ptr<TraceReader> trace,
+			     const Options &options, EventLoop *loop,
+			     FrameLogger *logger, ThreadPool *pool)
+	: trace_(std::move(trace)), name_("replay"), realTime_(!options.replayFast),
+	  numBuffers_(options.buffers ? options.buffers : kDefaultBuffers),
+	  cameraSinks_(!options.exportDir.empty() || options.gpu), loop_(loop),
+	  pipeline_(std::make_unique<FramePipeline>(name_, options, loop, logger,
+						    pool, nullptr, this)),
+	  heldFrames_(0), running_(false), next_(0), start_(0), origin_(0),
+	  waiting_(false), timer_(0), skipped_(0)
+{
+}
+
+ReplaySession::~ReplaySession()
+{
+	stop();
+
+	pipeline_.reset();
+	replayBuffers_.clear();
+	buffers_.clear();
+}
+
+/*
+ * Consumers are handed the replayed frames of the given stream, or of all
+ * streams if the stream index is negative, in the order they are added.
+ */
+void ReplaySession::addSink(std::unique_ptr<FrameSink> sink, int stream)
+{
+	pipeline_->addSink(std::move(sink), stream);
+}
+
+/*
+ * The streams are configured as in the trace, and the buffers allocated with
+ * the same layout as the captured buffers, so that the consumers are set up
+ * exactly as for the capture.
+ */
+int ReplaySession::init()
+{
+	const trace::Header &header = trace_->header();
+
+	if (!trace_->size()) {
+		std::cerr << name_ << ": The trace holds no frame" << std::endl;
+		return -EINVAL;
+	}
+
+	configs_.resize(header.numStreams);
+	buffers_.resize(header.numStreams);
+	freeFrames_.resize(header.numStreams);
+
+	for (unsigned int i = 0; i < header.numStreams; ++i) {
+		int ret = createBuffers(i);
+		if (ret < 0)
+			return ret;
+	}
+
+	std::cout << name_ << ": " << trace_->size() << " frames, "
+		  << header.numStreams << " streams, "
+		  << (realTime_ ? "original timing" : "maximum speed") << std::endl;
+
+	return createSinks();
+}
+
+int ReplaySession::createBuffers(unsigned int index)
+{
+	const trace::StreamInfo &info = trace_->header().streams[index];
+	StreamConfiguration &cfg = configs_[index];
+
+	cfg.pixelFormat = PixelFormat(info.fourcc, info.modifier);
+	cfg.size = Size(info.width, info.height);
+	cfg.stride = info.stride;
+	cfg.frameSize = info.frameSize;
+	cfg.bufferCount = numBuffers_;
+
+	size_t size = 0;
+	for (unsigned int i = 0; i < info.numPlanes; ++i)
+		size = std::max<size_t>(size, info.planeOffset[i] + info.planeLength[i]);
+
+	if (!info.numPlanes || info.numPlanes > FrameRecord::kMaxPlanes || !size) {
+		std::cerr << name_ << ": Invalid layout for stream" << index
+			  << std::endl;
+		return -EINVAL;
+	}
+
+	long pageSize = sysconf(_SC_PAGESIZE);
+	size = (size + pageSize - 1) / pageSize * pageSize;
+
+	bool dmabuf = false;
+
+	for (unsigned int i = 0; i < numBuffers_; ++i) {
+		int fd = allocateBuffer(size, &dmabuf);
+		if (fd < 0) {
+			std::cerr << name_ << ": Failed to allocate buffer: "
+				  << strerror(-fd) << std::endl;
+			return fd;
+		}
+
+		/* All the planes share the file descriptor, as captured. */
+		SharedFD sharedFd(std::move(fd));
+
+		std::vector<FrameBuffer::Plane> planes;
+		for (unsigned int j = 0; j < info.numPlanes; ++j) {
+			FrameBuffer::Plane plane;
+			plane.fd = sharedFd;
+			plane.offset = info.planeOffset[j];
+			plane.length = info.planeLength[j];
+			planes.push_back(plane);
+		}
+
+		/* The cookie indexes the replay buffer. */
+		std::unique_ptr<FrameBuffer> buffer =
+			std::make_unique<FrameBuffer>(planes, replayBuffers_.size());
+
+		std::unique_ptr<ReplayBuffer> replay = std::make_unique<ReplayBuffer>();
+		replay->image = Image::fromFrameBuffer(buffer.get(), Image::ReadWrite);
+		if (!replay->image) {
+			std::cerr << name_ << ": Failed to map buffer" << std::endl;
+			return -ENOMEM;
+		}
+
+		/* Copy the metadata for its planes, filled for every frame. */
+		replay->metadata = buffer->metadata();
+		replay->offset = 0;
+		replay->frame = std::make_unique<Frame>(pipeline_.get(), index, nullptr,
+							buffer.get(),
+							replay->image.get());
+		replay->frame->setMetadata(&replay->metadata);
+
+		freeFrames_[index].push_back(replay->frame.get());
+		buffers_[index].push_back(std::move(buffer));
+		replayBuffers_.push_back(std::move(replay));
+	}
+
+	std::cout << name_ << ": stream" << index << ": " << cfg.toString()
+		  << ", " << numBuffers_ << " buffers ("
+		  << (dmabuf ? "udmabuf" : "memfd") << ")" << std::endl;
+
+	return 0;
+}
+
+/*
+ * The consumers are created by the pipeline, as for a CameraSession.
+ * Consumers that require buffers allocated by a camera can't be used.
+ */
+int ReplaySession::createSinks()
+{
+	if (cameraSinks_) {
+		std::cerr << name_ << ": Export and GPU import require a camera"
+			  << std::endl;
+		return -ENOTSUP;
+	}
+
+	std::vector<FramePipeline::StreamConfig> streams;
+	for (unsigned int i = 0; i < configs_.size(); ++i)
+		streams.push_back({ configs_[i], &buffers_[i] });
+
+	return pipeline_->configure(streams);
+}
+
+int ReplaySession::start()
+{
+	int ret = pipeline_->start(numBuffers_);
+	if (ret < 0) {
+		pipeline_->stop();
+		return ret;
+	}
+
+	next_ = 0;
+	skipped_ = 0;
+	waiting_ = false;
+	origin_ = trace_->frame(0).completed;
+	start_ = monotonicNs();
+	running_ = true;
+
+	scheduleFrame();
+
+	return 0;
+}
+
+void ReplaySession::stop()
+{
+	if (!running_)
+		return;
+
+	running_ = false;
+
+	if (timer_) {
+		loop_->cancelTimer(timer_);
+		timer_ = 0;
+	}
+
+	pipeline_->stop();
+
+	for (unsigned int i = 0; i < configs_.size(); ++i)
+		pipeline_->stats(i).report(std::cout, name_ + ": stream" + std::to_string(i) + ": ");
+}
+
+/*
+ * Schedule the next frame of the trace, at the time it completed at relative
+ * to the first frame, or right away at maximum speed. The replay ends once
+ * all the frames have been released.
+ */
+void ReplaySession::scheduleFrame()
+{
+	if (next_ == trace_->size()) {
+		if (!heldFrames_)
+			loop_->exit();
+		return;
+	}
+
+	if (!realTime_) {
+		loop_->callLater([this]() { replayFrame(); });
+		return;
+	}
+
+	uint64_t completed = trace_->frame(next_).completed;
+	uint64_t due = start_ + (completed > origin_ ? completed - origin_ : 0);
+	uint64_t now = monotonicNs();
+
+	if (due <= now) {
+		loop_->callLater([this]() { replayFrame(); });
+		return;
+	}
+
+	timer_ = loop_->addTimer(std::chrono::microseconds((due - now) / 1000),
+				 [this]() {
+					 timer_ = 0;
+					 replayFrame();
+				 });
+}
+
+/*
+ * Fill a free buffer of the stream with the next frame of the trace, and
+ * complete it. The frame timestamps are shifted to the replay time, keeping
+ * their offset from the completion time, and then handed to the pipeline
+ * through the event loop, as the completed requests of a camera.
+ */
+void ReplaySession::replayFrame()
+{
+	if (!running_)
+		return;
+
+	const trace::FrameHeader &header = trace_->frame(next_);
+	std::vector<Frame *> &freeFrames = freeFrames_[header.record.stream];
+
+	if (freeFrames.empty()) {
+		/* At maximum speed, wait for the consumers to release a frame. */
+		if (!realTime_) {
+			waiting_ = true;
+			return;
+		}
+
+		skipped_++;
+		next_++;
+		scheduleFrame();
+		return;
+	}
+
+	Frame *frame = freeFrames.back();
+	freeFrames.pop_back();
+	heldFrames_++;
+
+	ReplayBuffer &buffer = *replayBuffers_[frame->buffer()->cookie()];
+	Image &image = *buffer.image;
+	FrameMetadata &metadata = buffer.metadata;
+	FrameRecord &record = frame->record();
+
+	record = header.record;
+	record.numPlanes = std::min<unsigned int>(image.numPlanes(),
+						  FrameRecord::kMaxPlanes);
+
+	for (unsigned int i = 0; i < record.numPlanes; ++i) {
+		Span<const uint8_t> data = trace_->data(next_, i);
+		size_t size = std::min(data.size(), image.data(i).size());
+
+		if (size)
+			memcpy(image.data(i).data(), data.data(), size);
+		metadata.planes()[i].bytesused = size;
+		record.bytesused[i] = size;
+	}
+
+	uint64_t completed = monotonicNs();
+	int64_t offset = completed - header.completed;
+
+	record.timestamp = header.record.timestamp + offset;
+
+	metadata.status = static_cast<FrameMetadata::Status>(header.status);
+	metadata.sequence = record.sequence;
+	metadata.timestamp = record.timestamp;
+
+	buffer.offset = offset;
+	frame->setCompleted(completed);
+
+	pipeline_->queue();
+	loop_->callLater([this, frame]() { processFrame(frame); });
+
+	next_++;
+	scheduleFrame();
+}
+
+/*
+ * Rebuild the typed values of the capture metadata from the controls of the
+ * frame record, shifting the sensor timestamp to the replay time. The values
+ * are decoded based on their recorded type, without looking up the controls.
+ */
+void ReplaySession::decodeMetadata(const FrameRecord &record, int64_t offset,
+				   CaptureMetadata *captured) const
+{
+	const CaptureMetadataFilter &metadataFilter = pipeline_->metadataFilter();
+
+	*captured = {};
+
+	for (unsigned int i = 0; i < record.numControls; ++i) {
+		const FrameRecord::Control &ctrl = record.controls[i];
+
+		switch (ctrl.type) {
+		case FrameRecord::Integer: {
+			int64_t value = ctrl.integer;
+			if (ctrl.id == controls::SensorTimestamp.id())
+				value += offset;
+
+			metadataFilter.matchScalar(ctrl.id, value, captured);
+			break;
+		}
+		case FrameRecord::Float:
+			metadataFilter.matchScalar(ctrl.id, ctrl.real, captured);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/*
+ * Process a replayed frame as a CameraSession processes a completed request
+ * with a single buffer.
+ */
+void ReplaySession::processFrame(Frame *frame)
+{
+	uint64_t now = monotonicNs();
+
+	AllocationScope allocations(pipeline_->countAllocations());
+	bool admitted = pipeline_->admit();
+
+	const ReplayBuffer &buffer = *replayBuffers_[frame->buffer()->cookie()];
+	decodeMetadata(frame->record(), buffer.offset, &frame->captureMetadata());
+
+	pipeline_->addFrame(frame, now);
+	pipeline_->dispatch(admitted);
+}
+
+/* Called by the pipeline, in the event loop thread, once a frame is released. */
+void ReplaySession::recycleFrame(Frame *frame)
+{
+	heldFrames_--;
+	freeFrames_[frame->streamIndex()].push_back(frame);
+
+	if (waiting_) {
+		waiting_ = false;
+		replayFrame();
+		return;
+	}
+
+	if (running_ && next_ == trace_->size() && !heldFrames_)
+		loop_->exit();
+}
+
+/*
+ * Print the benchmark summary of the replay, which lasted for the given
+ * duration in nanoseconds. At maximum speed, the frame and data rates are
+ * the throughput of the consumers.
+ */
+void ReplaySession::reportSummary(uint64_t duration) const
+{
+	for (unsigned int i = 0; i < configs_.size(); ++i) {
+		const FrameStats &stats = pipeline_->stats(i);
+
+		std::cout << name_ << ": stream" << i << ": "
+			  << configs_[i].toString() << ": " << stats.frames()
+			  << " frames, " << stats.dropped() << " dropped, "
+			  << std::fixed << std::setprecision(2)
+			  << stats.frameRate() << " fps, "
+			  << stats.byteRate() / 1000000.0 << " MB/s"
+			  << std::defaultfloat << std::endl;
+
+		const Histogram &dispatch = stats.dispatchLatency();
+		if (!dispatch.count())
+			continue;
+
+		std::cout << name_ << ": stream" << i << ": dispatch latency p99 "
+			  << std::fixed << std::setprecision(3)
+			  << dispatch.percentile(99) / 1000000.0 << " ms, p99.9 "
+			  << dispatch.percentile(99.9) / 1000000.0 << " ms"
+			  << std::defaultfloat << std::endl;
+	}
+
+	std::cout << name_ << ": " << next_ - skipped_ << " of " << trace_->size()
+		  << " frames replayed in " << duration / 1000000 << " ms";
+	if (skipped_)
+		std::cout << ", " << skipped_ << " skipped";
+	if (pipeline_->dropped())
+		std::cout << ", " << pipeline_->dropped() << " dropped by policy";
+	std::cout << std::endl;
+}
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * replay_session.h - Replay of a capture trace to the frame consumers
+ */
+#ifndef __SIMPLE_CAM_REPLAY_SESSION_H__
+#define __SIMPLE_CAM_REPLAY_SESSION_H__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/stream.h>
+
+#include "event_loop.h"
+#include "frame_pipeline.h"
+#include "frame_sink.h"
+#include "image.h"
+#include "metadata_filter.h"
+#include "options.h"
+#include "trace.h"
+
+class FrameLogger;
+class ThreadPool;
+
+/*
+ * A ReplaySession feeds the frames of a trace to the same consumers as a
+ * CameraSession, without any camera. It allows benchmarking and profiling the
+ * frame processing pipeline offline, on a machine without the camera, with
+ * the exact frames and timings of a real capture.
+ *
+ * Replayed frames are copied from the trace to buffers laid out as the
+ * captured ones, in memory shared with the consumers through dmabufs when
+ * udmabuf is available, and through memfds otherwise. They are then handed
+ * to the consumers in the order of the trace, either at the original frame
+ * timing, or as fast as the consumers release the buffers. The frames go
+ * through the same FramePipeline as captured frames, with the same drop
+ * policy, reordering, statistics and allocation counting.
+ *
+ * At the original timing, frames that come when all the buffers of their
+ * stream are held by the consumers are skipped, as a camera would drop them.
+ * The replay ends at the end of the trace, once all frames have been
+ * released.
+ */
+class ReplaySession : public FramePipeline::Source
+{
+public:
+	ReplaySession(std::unique_ptr<TraceReader> trace, const Options &options,
+		      EventLoop *loop, FrameLogger *logger,
+		      ThreadPool *pool = nullptr);
+	~ReplaySession();
+
+	const std::string &name() const { return name_; }
+
+	void addSink(std::unique_ptr<FrameSink> sink, int stream = -1);
+
+	int init();
+	int start();
+	void stop();
+
+	void reportSummary(uint64_t duration) const;
+
+	/*
+	 * True if the trace is truncated, or if a consumer failed during the
+	 * replay, once stopped.
+	 */
+	bool failed() const { return trace_->truncated() || pipeline_->failed(); }
+
+	/* Number of frames processed while counting heap allocations. */
+	uint64_t countedRequests() const { return pipeline_->countedRequests(); }
+
+private:
+	/*
+	 * A replay buffer, with its mapping and the metadata of its frame, and
+	 * the offset of the replay time from the capture time of the frame.
+	 */
+	struct ReplayBuffer {
+		std::unique_ptr<Image> image;
+		std::unique_ptr<Frame> frame;
+		libcamera::FrameMetadata metadata;
+		int64_t offset;
+	};
+
+	int createBuffers(unsigned int index);
+	int createSinks();
+
+	void scheduleFrame();
+	void replayFrame();
+	void processFrame(Frame *frame);
+	void recycleFrame(Frame *frame) override;
+
+	void decodeMetadata(const FrameRecord &record, int64_t offset,
+			    CaptureMetadata *captured) const;
+
+	std::unique_ptr<TraceReader> trace_;
+	std::string name_;
+	bool realTime_;
+	unsigned int numBuffers_;
+	bool cameraSinks_;
+
+	EventLoop *loop_;
+	std::unique_ptr<FramePipeline> pipeline_;
+
+	/* The configuration and buffers of each stream, as in the trace. */
+	std::vector<libcamera::StreamConfiguration> configs_;
+	std::vector<std::vector<std::unique_ptr<libcamera::FrameBuffer>>> buffers_;
+	std::vector<std::unique_ptr<ReplayBuffer>> replayBuffers_;
+	std::vector<std::vector<Frame *>> freeFrames_;
+	unsigned int heldFrames_;
+
+	/*
+	 * Frames are replayed at the time they completed at in the trace,
+	 * relative to the completion of the first frame.
+	 */
+	bool running_;
+	size_t next_;
+	uint64_t start_;
+	uint64_t origin_;
+	bool waiting_;
+	EventLoop::TimerId timer_;
+	uint64_t skipped_;
+};
+
+#endif /* __SIMPLE_CAM_REPLAY_SESSION_H__ */
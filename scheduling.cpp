@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * scheduling.cpp - Thread placement and real-time scheduling helpers
+ */
+
+#include "scheduling.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+/*
+ * Restrict the calling thread to the given set of CPUs. CPUs that don't fit in
+ * a cpu_set_t are rejected.
+ */
+int setThreadAffinity(const std::vector<unsigned int> &cpus)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	for (unsigned int cpu : cpus) {
+		if (cpu >= CPU_SETSIZE)
+			return -EINVAL;
+
+		CPU_SET(cpu, &set);
+	}
+
+	return -pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * Run the calling thread with the SCHED_FIFO real-time policy, at the given
+ * priority, to keep it from being preempted by regular threads. This normally
+ * requires the CAP_SYS_NICE capability, or an RLIMIT_RTPRIO limit.
+ */
+int setThreadRealtime(int priority)
+{
+	struct sched_param param = {};
+	param.sched_priority = priority;
+
+	return -pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+/* Describe the scheduling policy and CPU affinity of the calling thread. */
+std::string threadScheduling()
+{
+	struct sched_param param;
+	int policy;
+	std::string info;
+
+	if (!pthread_getschedparam(pthread_self(), &policy, &param) &&
+	    policy == SCHED_FIFO)
+		info = "SCHED_FIFO " + std::to_string(param.sched_priority);
+	else
+		info = "SCHED_OTHER";
+
+	cpu_set_t set;
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set))
+		return info;
+
+	/* Don't list the CPUs when the thread can run on all of them. */
+	if (CPU_COUNT(&set) >= sysconf(_SC_NPROCESSORS_ONLN))
+		return info;
+
+	std::string cpus;
+	for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, &set))
+			continue;
+		if (!cpus.empty())
+			cpus += ",";
+		cpus += std::to_string(cpu);
+	}
+
+	return info + ", CPUs " + cpus;
+}
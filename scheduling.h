@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * scheduling.h - Thread placement and real-time scheduling helpers
+ */
+#ifndef __SIMPLE_CAM_SCHEDULING_H__
+#define __SIMPLE_CAM_SCHEDULING_H__
+
+#include <string>
+#include <vector>
+
+int setThreadAffinity(const std::vector<unsigned int> &cpus);
+int setThreadRealtime(int priority);
+std::string threadScheduling();
+
+#endif /* __SIMPLE_CAM_SCHEDULING_H__ */
@@ -5,112 +5,40 @@
  * A simple libcamera capture example
  */
 
+#include <algorithm>
+#include <errno.h>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
 
 #include <libcamera/libcamera.h>
 
+#include "allocation_counter.h"
+#include "camera_session.h"
+#include "clock.h"
 #include "event_loop.h"
-
-#define TIMEOUT_SEC 3
+#include "frame_logger.h"
+#include "metrics.h"
+#include "metrics_server.h"
+#include "numa.h"
+#include "options.h"
+#include "recording.h"
+#include "replay_session.h"
+#include "scheduling.h"
+#include "thread_pool.h"
+#include "trace.h"
 
 using namespace libcamera;
-static std::shared_ptr<Camera> camera;
 static EventLoop loop;
 
-/*
- * --------------------------------------------------------------------
- * Handle RequestComplete
- *
- * For each Camera::requestCompleted Signal emitted from the Camera the
- * connected Slot is invoked.
- *
- * The Slot is invoked in the CameraManager's thread, hence one should avoid
- * any heavy processing here. The processing of the request shall be re-directed
- * to the application's thread instead, so as not to block the CameraManager's
- * thread for large amount of time.
- *
- * The Slot receives the Request as a parameter.
- */
-
-static void processRequest(Request *request);
-
-static void requestComplete(Request *request)
-{
-	if (request->status() == Request::RequestCancelled)
-		return;
-
-	loop.callLater(std::bind(&processRequest, request));
-}
-
-static void processRequest(Request *request)
-{
-	std::cout << std::endl
-		  << "Request completed: " << request->toString() << std::endl;
-
-	/*
-	 * When a request has completed, it is populated with a metadata control
-	 * list that allows an application to determine various properties of
-	 * the completed request. This can include the timestamp of the Sensor
-	 * capture, or its gain and exposure values, or properties from the IPA
-	 * such as the state of the 3A algorithms.
-	 *
-	 * ControlValue types have a toString, so to examine each request, print
-	 * all the metadata for inspection. A custom application can parse each
-	 * of these items and process them according to its needs.
-	 */
-	const ControlList &requestMetadata = request->metadata();
-	for (const auto &ctrl : requestMetadata) {
-		const ControlId *id = controls::controls.at(ctrl.first);
-		const ControlValue &value = ctrl.second;
-
-		std::cout << "\t" << id->name() << " = " << value.toString()
-			  << std::endl;
-	}
-
-	/*
-	 * Each buffer has its own FrameMetadata to describe its state, or the
-	 * usage of each buffer. While in our simple capture we only provide one
-	 * buffer per request, a request can have a buffer for each stream that
-	 * is established when configuring the camera.
-	 *
-	 * This allows a viewfinder and a still image to be processed at the
-	 * same time, or to allow obtaining the RAW capture buffer from the
-	 * sensor along with the image as processed by the ISP.
-	 */
-	const Request::BufferMap &buffers = request->buffers();
-	for (auto bufferPair : buffers) {
-		// (Unused) Stream *stream = bufferPair.first;
-		FrameBuffer *buffer = bufferPair.second;
-		const FrameMetadata &metadata = buffer->metadata();
-
-		/* Print some information about the buffer which has completed. */
-		std::cout << " seq: " << std::setw(6) << std::setfill('0') << metadata.sequence
-			  << " timestamp: " << metadata.timestamp
-			  << " bytesused: ";
-
-		unsigned int nplane = 0;
-		for (const FrameMetadata::Plane &plane : metadata.planes())
-		{
-			std::cout << plane.bytesused;
-			if (++nplane < metadata.planes().size())
-				std::cout << "/";
-		}
-
-		std::cout << std::endl;
-
-		/*
-		 * Image data can be accessed here, but the FrameBuffer
-		 * must be mapped by the application
-		 */
-	}
-
-	/* Re-queue the Request to the camera. */
-	request->reuse(Request::ReuseBuffers);
-	camera->queueRequest(request);
-}
-
 /*
  * ----------------------------------------------------------------------------
  * Camera Naming.
@@ -156,8 +84,225 @@ std::string cameraName(Camera *camera)
 	return name;
 }
 
-int main()
+/*
+ * Find the cameras selected on the command line, by index or by ID. When
+ * none is selected, default to the first camera.
+ */
+static std::vector<std::shared_ptr<Camera>>
+selectCameras(CameraManager *cm, const Options &options)
+{
+	std::vector<std::shared_ptr<Camera>> cameras = cm->cameras();
+
+	if (options.allCameras)
+		return cameras;
+
+	if (options.cameras.empty())
+		return { cameras[0] };
+
+	std::vector<std::shared_ptr<Camera>> selected;
+
+	for (const std::string &name : options.cameras) {
+		std::shared_ptr<Camera> camera = cm->get(name);
+
+		if (!camera) {
+			char *end;
+			unsigned long index = strtoul(name.c_str(), &end, 10);
+			if (*end == '\0' && index < cameras.size())
+				camera = cameras[index];
+		}
+
+		if (!camera) {
+			std::cerr << "Camera " << name << " not found" << std::endl;
+			return {};
+		}
+
+		selected.push_back(camera);
+	}
+
+	return selected;
+}
+
+/*
+ * Configure the cameras, allocate their buffers and requests, and start them.
+ * This is done one camera after the other by default. For a fast start-up,
+ * each camera is instead set up and started from its own thread as soon as
+ * possible, without waiting for the other cameras to be configured.
+ */
+static int startSessions(std::vector<std::unique_ptr<CameraSession>> &sessions,
+			 bool concurrent)
+{
+	if (!concurrent) {
+		for (std::unique_ptr<CameraSession> &session : sessions) {
+			if (session->init() < 0)
+				return -1;
+		}
+
+		for (std::unique_ptr<CameraSession> &session : sessions) {
+			if (session->start() < 0)
+				return -1;
+		}
+
+		return 0;
+	}
+
+	std::vector<std::thread> threads;
+	std::vector<int> results(sessions.size());
+
+	for (unsigned int i = 0; i < sessions.size(); ++i) {
+		threads.emplace_back([&sessions, &results, i]() {
+			CameraSession *session = sessions[i].get();
+
+			results[i] = session->init();
+			if (results[i] >= 0)
+				results[i] = session->start();
+		});
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	for (int result : results) {
+		if (result < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Replay a capture trace to the consumers, without any camera. The replay
+ * runs on the application event loop until the end of the trace, regardless
+ * of the capture duration.
+ */
+/*
+ * Once warmed up, the frame processing path must not allocate memory.
+ * Any heap allocation is a failure.
+ */
+static int checkAllocations(uint64_t requests)
+{
+	uint64_t allocations = AllocationScope::count();
+
+	std::cout << allocations << " heap allocations in " << requests
+		  << " processed requests" << std::endl;
+
+	if (!requests) {
+		std::cerr << "No request processed after the warmup" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (allocations) {
+		std::cerr << "Frame processing allocated memory ("
+			  << std::fixed << std::setprecision(2)
+			  << static_cast<double>(allocations) / requests
+			  << " allocations per request)" << std::defaultfloat
+			  << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int replayTrace(const Options &options, FrameLogger *logger)
+{
+	std::unique_ptr<TraceReader> trace = TraceReader::open(options.replay);
+	if (!trace)
+		return EXIT_FAILURE;
+
+	std::unique_ptr<ThreadPool> pool;
+	if (options.workers)
+		pool = std::make_unique<ThreadPool>(options.workers);
+
+	if (options.countAllocations)
+		AllocationScope::enable();
+
+	ReplaySession session(std::move(trace), options, &loop, logger, pool.get());
+	if (session.init() < 0 || session.start() < 0)
+		return EXIT_FAILURE;
+
+	struct timespec cpuStart;
+	struct timespec cpuEnd;
+
+	uint64_t start = monotonicNs();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+
+	int ret = loop.exec();
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+	uint64_t duration = monotonicNs() - start;
+	uint64_t cpuTime = (cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000000ULL
+			 + cpuEnd.tv_nsec - cpuStart.tv_nsec;
+
+	session.stop();
+
+	std::cout << "Replay ran for " << duration / 1000000 << " ms and "
+		  << "stopped with exit status: " << ret << std::endl;
+
+	if (options.benchmark) {
+		std::cout << std::endl << "Benchmark summary (replay of "
+			  << options.replay << "):" << std::endl;
+
+		session.reportSummary(duration);
+
+		std::cout << "main loop CPU usage " << std::fixed
+			  << std::setprecision(1) << cpuTime * 100.0 / duration
+			  << "%" << std::defaultfloat << " (" << threadScheduling()
+			  << ")" << std::endl;
+	}
+
+	if (ret || session.failed())
+		return EXIT_FAILURE;
+
+	if (options.countAllocations)
+		return checkAllocations(session.countedRequests());
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
 {
+	Options options;
+
+	int ret = parseOptions(argc, argv, &options);
+	if (ret)
+		return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (!options.dumpLog.empty())
+		return FrameLogger::dump(options.dumpLog, std::cout) < 0
+			? EXIT_FAILURE : EXIT_SUCCESS;
+
+	if (!options.dumpRecording.empty())
+		return RecordingReader::dump(options.dumpRecording,
+					     options.dumpTimestamp, std::cout) < 0
+			? EXIT_FAILURE : EXIT_SUCCESS;
+
+	/*
+	 * The capture can be paused with SIGUSR1 and resumed with SIGUSR2.
+	 * The signals are blocked before any thread is created, so that all
+	 * threads inherit the mask, and are received by the event loop
+	 * through a signalfd.
+	 */
+	sigset_t pauseSignals;
+	sigemptyset(&pauseSignals);
+	sigaddset(&pauseSignals, SIGUSR1);
+	sigaddset(&pauseSignals, SIGUSR2);
+	pthread_sigmask(SIG_BLOCK, &pauseSignals, nullptr);
+
+	/*
+	 * Per-frame information is logged from a background thread, to keep
+	 * slow I/O out of the capture path. Benchmarks skip the per-frame
+	 * output, unless explicitly logged to a file.
+	 */
+	FrameLogger logger;
+	bool logging = !options.benchmark || !options.logFile.empty();
+	if (logging && logger.start(options.logFile) < 0)
+		return EXIT_FAILURE;
+
+	if (!options.replay.empty()) {
+		ret = replayTrace(options, logging ? &logger : nullptr);
+		logger.stop();
+		return ret;
+	}
+
 	/*
 	 * --------------------------------------------------------------------
 	 * Create a Camera Manager.
@@ -197,16 +342,12 @@ int main()
 	 * In general terms, a Camera corresponds to a single image source
 	 * available in the system, such as an image sensor.
 	 *
-	 * Application lock usage of Camera by 'acquiring' them.
-	 * Once done with it, application shall similarly 'release' the Camera.
-	 *
 	 * As an example, use the first available camera in the system after
-	 * making sure that at least one camera is available.
+	 * making sure that at least one camera is available, unless other
+	 * cameras have been selected on the command line.
 	 *
-	 * Cameras can be obtained by their ID or their index, to demonstrate
-	 * this, the following code gets the ID of the first camera; then gets
-	 * the camera associated with that ID (which is of course the same as
-	 * cm->cameras()[0]).
+	 * Cameras can be obtained by their ID or their index. Several cameras
+	 * can be operated concurrently, each of them in its own CameraSession.
 	 */
 	if (cm->cameras().empty()) {
 		std::cout << "No cameras were identified on the system."
@@ -215,247 +356,212 @@ int main()
 		return EXIT_FAILURE;
 	}
 
-	std::string cameraId = cm->cameras()[0]->id();
-	camera = cm->get(cameraId);
-	camera->acquire();
-
-	/*
-	 * Stream
-	 *
-	 * Each Camera supports a variable number of Stream. A Stream is
-	 * produced by processing data produced by an image source, usually
-	 * by an ISP.
-	 *
-	 *   +-------------------------------------------------------+
-	 *   | Camera                                                |
-	 *   |                +-----------+                          |
-	 *   | +--------+     |           |------> [  Main output  ] |
-	 *   | | Image  |     |           |                          |
-	 *   | |        |---->|    ISP    |------> [   Viewfinder  ] |
-	 *   | | Source |     |           |                          |
-	 *   | +--------+     |           |------> [ Still Capture ] |
-	 *   |                +-----------+                          |
-	 *   +-------------------------------------------------------+
-	 *
-	 * The number and capabilities of the Stream in a Camera are
-	 * a platform dependent property, and it's the pipeline handler
-	 * implementation that has the responsibility of correctly
-	 * report them.
-	 */
+	std::vector<std::shared_ptr<Camera>> cameras = selectCameras(cm.get(), options);
+	if (cameras.empty()) {
+		cm->stop();
+		return EXIT_FAILURE;
+	}
 
 	/*
-	 * --------------------------------------------------------------------
-	 * Camera Configuration.
-	 *
-	 * Camera configuration is tricky! It boils down to assign resources
-	 * of the system (such as DMA engines, scalers, format converters) to
-	 * the different image streams an application has requested.
-	 *
-	 * Depending on the system characteristics, some combinations of
-	 * sizes, formats and stream usages might or might not be possible.
+	 * Each CameraSession configures its camera, allocates its buffers and
+	 * requests, and handles its request completions. Sessions share the
+	 * application event loop, unless running threaded, in which case each
+	 * of them runs its own event loop in a dedicated thread.
 	 *
-	 * A Camera produces a CameraConfigration based on a set of intended
-	 * roles for each Stream the application requires.
+	 * Frames can additionally be processed in parallel by a pool of worker
+	 * threads shared by all sessions.
 	 */
-	std::unique_ptr<CameraConfiguration> config =
-		camera->generateConfiguration( { StreamRole::Viewfinder } );
+	if (options.countAllocations)
+		AllocationScope::enable();
 
 	/*
-	 * The CameraConfiguration contains a StreamConfiguration instance
-	 * for each StreamRole requested by the application, provided
-	 * the Camera can support all of them.
-	 *
-	 * Each StreamConfiguration has default size and format, assigned
-	 * by the Camera depending on the Role the application has requested.
+	 * With NUMA placement, the workers are spread over the nodes of the
+	 * cameras if they are all given, or over all nodes otherwise.
 	 */
-	StreamConfiguration &streamConfig = config->at(0);
-	std::cout << "Default viewfinder configuration is: "
-		  << streamConfig.toString() << std::endl;
+	std::vector<unsigned int> nodes;
+	if (options.numa) {
+		if (options.numaNodes.size() >= cameras.size()) {
+			nodes.assign(options.numaNodes.begin(),
+				     options.numaNodes.begin() + cameras.size());
+			std::sort(nodes.begin(), nodes.end());
+			nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		} else {
+			nodes = numaNodes();
+		}
+	}
 
 	/*
-	 * Each StreamConfiguration parameter which is part of a
-	 * CameraConfiguration can be independently modified by the
-	 * application.
-	 *
-	 * In order to validate the modified parameter, the CameraConfiguration
-	 * should be validated -before- the CameraConfiguration gets applied
-	 * to the Camera.
-	 *
-	 * The CameraConfiguration validation process adjusts each
-	 * StreamConfiguration to a valid value.
+	 * Metrics are updated by all the threads, and served from the
+	 * application event loop.
 	 */
+	std::unique_ptr<Metrics> metrics;
+	if (!options.metricsAddress.empty())
+		metrics = std::make_unique<Metrics>();
 
-	/*
-	 * The Camera configuration procedure fails with invalid parameters.
-	 */
-#if 0
-	streamConfig.size.width = 0; //4096
-	streamConfig.size.height = 0; //2560
+	std::unique_ptr<ThreadPool> pool;
+	if (options.workers)
+		pool = std::make_unique<ThreadPool>(options.workers, 64, nodes);
 
-	int ret = camera->configure(config.get());
-	if (ret) {
-		std::cout << "CONFIGURATION FAILED!" << std::endl;
-		return EXIT_FAILURE;
-	}
-#endif
+	std::vector<std::unique_ptr<CameraSession>> sessions;
 
-	/*
-	 * Validating a CameraConfiguration -before- applying it will adjust it
-	 * to a valid configuration which is as close as possible to the one
-	 * requested.
-	 */
-	config->validate();
-	std::cout << "Validated viewfinder configuration is: "
-		  << streamConfig.toString() << std::endl;
+	for (unsigned int i = 0; i < cameras.size(); ++i) {
+		std::unique_ptr<CameraSession> session =
+			std::make_unique<CameraSession>(cameras[i], i, options,
+							&loop, logging ? &logger : nullptr,
+							pool.get(), metrics.get());
 
-	/*
-	 * Once we have a validated configuration, we can apply it to the
-	 * Camera.
-	 */
-	camera->configure(config.get());
+		std::cout << session->name() << ": "
+			  << cameraName(cameras[i].get()) << std::endl;
 
-	/*
-	 * --------------------------------------------------------------------
-	 * Buffer Allocation
-	 *
-	 * Now that a camera has been configured, it knows all about its
-	 * Streams sizes and formats. The captured images need to be stored in
-	 * framebuffers which can either be provided by the application to the
-	 * library, or allocated in the Camera and exposed to the application
-	 * by libcamera.
-	 *
-	 * An application may decide to allocate framebuffers from elsewhere,
-	 * for example in memory allocated by the display driver that will
-	 * render the captured frames. The application will provide them to
-	 * libcamera by constructing FrameBuffer instances to capture images
-	 * directly into.
-	 *
-	 * Alternatively libcamera can help the application by exporting
-	 * buffers allocated in the Camera using a FrameBufferAllocator
-	 * instance and referencing a configured Camera to determine the
-	 * appropriate buffer size and types to create.
-	 */
-	FrameBufferAllocator *allocator = new FrameBufferAllocator(camera);
+		sessions.push_back(std::move(session));
+	}
 
-	for (StreamConfiguration &cfg : *config) {
-		int ret = allocator->allocate(cfg.stream());
-		if (ret < 0) {
-			std::cerr << "Can't allocate buffers" << std::endl;
-			return EXIT_FAILURE;
-		}
+	if (startSessions(sessions, options.fastStart) < 0) {
+		sessions.clear();
+		cm->stop();
+		return EXIT_FAILURE;
+	}
 
-		size_t allocated = allocator->buffers(cfg.stream()).size();
-		std::cout << "Allocated " << allocated << " buffers for stream" << std::endl;
+	std::unique_ptr<MetricsServer> server;
+	if (metrics) {
+		server = std::make_unique<MetricsServer>(&loop, metrics.get());
+		if (server->start(options.metricsAddress) < 0)
+			server.reset();
 	}
 
 	/*
 	 * --------------------------------------------------------------------
-	 * Frame Capture
-	 *
-	 * libcamera frames capture model is based on the 'Request' concept.
-	 * For each frame a Request has to be queued to the Camera.
+	 * Run an EventLoop
 	 *
-	 * A Request refers to (at least one) Stream for which a Buffer that
-	 * will be filled with image data shall be added to the Request.
+	 * In order to dispatch events received from the video devices, such
+	 * as buffer completions, an event loop has to be run.
 	 *
-	 * A Request is associated with a list of Controls, which are tunable
-	 * parameters (similar to v4l2_controls) that have to be applied to
-	 * the image.
+	 * The time and CPU usage of the loop are measured for benchmarking.
 	 *
-	 * Once a request completes, all its buffers will contain image data
-	 * that applications can access and for each of them a list of metadata
-	 * properties that reports the capture parameters applied to the image.
+	 * For low latency processing, the thread running the loop can be
+	 * pinned to dedicated CPUs, and run with a real-time priority. This is
+	 * done once all other threads have been created, as new threads
+	 * inherit the scheduling parameters of their parent.
 	 */
-	Stream *stream = streamConfig.stream();
-	const std::vector<std::unique_ptr<FrameBuffer>> &buffers = allocator->buffers(stream);
-	std::vector<std::unique_ptr<Request>> requests;
-	for (unsigned int i = 0; i < buffers.size(); ++i) {
-		std::unique_ptr<Request> request = camera->createRequest();
-		if (!request)
-		{
-			std::cerr << "Can't create request" << std::endl;
-			return EXIT_FAILURE;
+	std::vector<unsigned int> loopCpus = options.loopCpus;
+	if (loopCpus.empty() && options.numa && !options.threaded) {
+		/* The loop follows the cameras if they are all on the same node. */
+		int node = sessions[0]->numaNode();
+		for (const std::unique_ptr<CameraSession> &session : sessions) {
+			if (session->numaNode() != node)
+				node = -1;
 		}
 
-		const std::unique_ptr<FrameBuffer> &buffer = buffers[i];
-		int ret = request->addBuffer(stream, buffer.get());
+		if (node >= 0)
+			loopCpus = numaNodeCpus(node);
+	}
+
+	if (!loopCpus.empty()) {
+		ret = setThreadAffinity(loopCpus);
 		if (ret < 0)
-		{
-			std::cerr << "Can't set buffer for request"
+			std::cerr << "Failed to set CPU affinity: " << strerror(-ret)
 				  << std::endl;
-			return EXIT_FAILURE;
-		}
+	}
 
-		/*
-		 * Controls can be added to a request on a per frame basis.
-		 */
-		ControlList &controls = request->controls();
-		controls.set(controls::Brightness, 0.5);
+	if (options.rtPriority) {
+		ret = setThreadRealtime(options.rtPriority);
+		if (ret < 0)
+			std::cerr << "Failed to set real-time priority: "
+				  << strerror(-ret) << std::endl;
+	}
 
-		requests.push_back(std::move(request));
+	int signalFd = signalfd(-1, &pauseSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signalFd < 0) {
+		std::cerr << "Failed to create signalfd: " << strerror(errno)
+			  << std::endl;
+	} else {
+		loop.addFdEvent(signalFd, EventLoop::Read, [signalFd, &sessions]() {
+			struct signalfd_siginfo info;
+
+			while (read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+				for (std::unique_ptr<CameraSession> &session : sessions) {
+					if (info.ssi_signo == SIGUSR1)
+						session->pause();
+					else
+						session->resume();
+				}
+			}
+		});
 	}
 
-	/*
-	 * --------------------------------------------------------------------
-	 * Signal&Slots
-	 *
-	 * libcamera uses a Signal&Slot based system to connect events to
-	 * callback operations meant to handle them, inspired by the QT graphic
-	 * toolkit.
-	 *
-	 * Signals are events 'emitted' by a class instance.
-	 * Slots are callbacks that can be 'connected' to a Signal.
-	 *
-	 * A Camera exposes Signals, to report the completion of a Request and
-	 * the completion of a Buffer part of a Request to support partial
-	 * Request completions.
-	 *
-	 * In order to receive the notification for request completions,
-	 * applications shall connecte a Slot to the Camera 'requestCompleted'
-	 * Signal before the camera is started.
-	 */
-	camera->requestCompleted.connect(requestComplete);
+	struct timespec cpuStart;
+	struct timespec cpuEnd;
 
-	/*
-	 * --------------------------------------------------------------------
-	 * Start Capture
-	 *
-	 * In order to capture frames the Camera has to be started and
-	 * Request queued to it. Enough Request to fill the Camera pipeline
-	 * depth have to be queued before the Camera start delivering frames.
-	 *
-	 * For each delivered frame, the Slot connected to the
-	 * Camera::requestCompleted Signal is called.
-	 */
-	camera->start();
-	for (std::unique_ptr<Request> &request : requests)
-		camera->queueRequest(request.get());
+	uint64_t start = monotonicNs();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
 
-	/*
-	 * --------------------------------------------------------------------
-	 * Run an EventLoop
-	 *
-	 * In order to dispatch events received from the video devices, such
-	 * as buffer completions, an event loop has to be run.
-	 */
-	loop.timeout(TIMEOUT_SEC);
-	int ret = loop.exec();
-	std::cout << "Capture ran for " << TIMEOUT_SEC << " seconds and "
+	loop.timeout(options.duration);
+	ret = loop.exec();
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+	uint64_t duration = monotonicNs() - start;
+	uint64_t cpuTime = (cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000000ULL
+			 + cpuEnd.tv_nsec - cpuStart.tv_nsec;
+
+	std::cout << "Capture ran for " << options.duration << " seconds and "
 		  << "stopped with exit status: " << ret << std::endl;
 
 	/*
 	 * --------------------------------------------------------------------
 	 * Clean Up
 	 *
-	 * Stop the Camera, release resources and stop the CameraManager.
+	 * Stop the Cameras, release resources and stop the CameraManager.
 	 * libcamera has now released all resources it owned.
 	 */
-	camera->stop();
-	allocator->free(stream);
-	delete allocator;
-	camera->release();
-	camera.reset();
+	if (signalFd >= 0) {
+		loop.removeFdEvent(signalFd);
+		close(signalFd);
+	}
+
+	for (std::unique_ptr<CameraSession> &session : sessions)
+		session->stop();
+
+	for (std::unique_ptr<CameraSession> &session : sessions)
+		session->reportStartup();
+
+	/*
+	 * The benchmark summary reports the achieved frame and data rates
+	 * of each stream, and the CPU usage of the event loop threads.
+	 */
+	if (options.benchmark) {
+		std::cout << std::endl << "Benchmark summary (libcamera "
+			  << CameraManager::version() << ", "
+			  << duration / 1000000 << " ms):" << std::endl;
+
+		for (std::unique_ptr<CameraSession> &session : sessions)
+			session->reportSummary(duration);
+
+		std::cout << "main loop CPU usage " << std::fixed
+			  << std::setprecision(1) << cpuTime * 100.0 / duration
+			  << "%" << std::defaultfloat << " (" << threadScheduling()
+			  << ")" << std::endl;
+	}
+
+	int status = EXIT_SUCCESS;
+
+	for (std::unique_ptr<CameraSession> &session : sessions) {
+		if (session->failed())
+			status = EXIT_FAILURE;
+	}
+
+	if (options.countAllocations) {
+		uint64_t requests = 0;
+		for (std::unique_ptr<CameraSession> &session : sessions)
+			requests += session->countedRequests();
+
+		status = checkAllocations(requests);
+	}
+
+	sessions.clear();
+	cameras.clear();
 	cm->stop();
 
-	return EXIT_SUCCESS;
+	logger.stop();
+
+	return status;
 }
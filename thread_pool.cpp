@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * thread_pool.cpp - Work-stealing pool of worker threads
+ */
+
+#include "thread_pool.h"
+
+#include <iostream>
+#include <string.h>
+
+#include "numa.h"
+#include "scheduling.h"
+
+ThreadPool::ThreadPool(unsigned int numThreads, size_t queueSize,
+		       const std::vector<unsigned int> &nodes)
+	: next_(0), pending_(0), idle_(0), exit_(false)
+{
+	for (unsigned int i = 0; i < numThreads; ++i) {
+		workers_.push_back(std::make_unique<Worker>(queueSize));
+
+		if (nodes.empty())
+			continue;
+
+		/* Spread the workers evenly over the nodes. */
+		unsigned int node = nodes[i % nodes.size()];
+		if (node >= nodeWorkers_.size())
+			nodeWorkers_.resize(node + 1);
+
+		nodeWorkers_[node].push_back(i);
+		workers_[i]->node = node;
+		workers_[i]->cpus = numaNodeCpus(node);
+	}
+
+	/* Pop from the own queue first, then from the same node, then others. */
+	for (unsigned int i = 0; i < numThreads; ++i) {
+		Worker *worker = workers_[i].get();
+
+		for (unsigned int j = 0; j < numThreads; ++j) {
+			unsigned int index = (i + j) % numThreads;
+			if (workers_[index]->node == worker->node)
+				worker->order.push_back(index);
+		}
+
+		for (unsigned int j = 0; j < numThreads; ++j) {
+			unsigned int index = (i + j) % numThreads;
+			if (workers_[index]->node != worker->node)
+				worker->order.push_back(index);
+		}
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+		workers_[i]->thread = std::thread(&ThreadPool::run, this, i);
+}
+
+/* Pending tasks are completed before the worker threads exit. */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		exit_ = true;
+	}
+
+	cond_.notify_all();
+
+	for (std::unique_ptr<Worker> &worker : workers_)
+		worker->thread.join();
+}
+
+/*
+ * Queue a task for execution by a worker thread, preferably one of the given
+ * NUMA node. This can be called from any thread.
+ */
+void ThreadPool::submit(Callable &&task, int node)
+{
+	unsigned int first = next_.fetch_add(1, std::memory_order_relaxed);
+	bool queued = false;
+
+	if (node >= 0 && static_cast<unsigned int>(node) < nodeWorkers_.size()) {
+		const std::vector<unsigned int> &local = nodeWorkers_[node];
+
+		for (unsigned int i = 0; i < local.size() && !queued; ++i)
+			queued = push(workers_[local[(first + i) % local.size()]].get(),
+				      std::move(task));
+	}
+
+	for (unsigned int i = 0; i < workers_.size() && !queued; ++i)
+		queued = push(workers_[(first + i) % workers_.size()].get(),
+			      std::move(task));
+
+	if (!queued) {
+		task();
+		return;
+	}
+
+	std::unique_lock<std::mutex> locker(lock_);
+	pending_.fetch_add(1, std::memory_order_relaxed);
+	if (idle_)
+		cond_.notify_one();
+}
+
+bool ThreadPool::push(Worker *worker, Callable &&task)
+{
+	std::unique_lock<std::mutex> locker(worker->lock);
+
+	if (worker->count == worker->tasks.size())
+		return false;
+
+	size_t index = (worker->head + worker->count) % worker->tasks.size();
+	worker->tasks[index] = std::move(task);
+	worker->count++;
+
+	return true;
+}
+
+/*
+ * Take the oldest task from a queue. Workers and thieves both take tasks in
+ * submission order, to keep the processing order close to the capture order.
+ */
+bool ThreadPool::pop(Worker *worker, Callable *task)
+{
+	std::unique_lock<std::mutex> locker(worker->lock);
+
+	if (!worker->count)
+		return false;
+
+	*task = std::move(worker->tasks[worker->head]);
+	worker->head = (worker->head + 1) % worker->tasks.size();
+	worker->count--;
+
+	return true;
+}
+
+void ThreadPool::run(unsigned int index)
+{
+	const Worker *worker = workers_[index].get();
+	Callable task;
+
+	if (!worker->cpus.empty()) {
+		int ret = setThreadAffinity(worker->cpus);
+		if (ret < 0)
+			std::cerr << "Failed to bind worker to node " << worker->node
+				  << ": " << strerror(-ret) << std::endl;
+	}
+
+	for (;;) {
+		bool found = false;
+
+		/* Try the worker's own queue first, then steal from the others. */
+		for (unsigned int i = 0; i < worker->order.size() && !found; ++i)
+			found = pop(workers_[worker->order[i]].get(), &task);
+
+		if (found) {
+			pending_.fetch_sub(1, std::memory_order_relaxed);
+			task();
+			task.reset();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> locker(lock_);
+
+		if (pending_.load(std::memory_order_relaxed) > 0)
+			continue;
+
+		if (exit_)
+			break;
+
+		idle_++;
+		cond_.wait(locker, [&]() {
+			return pending_.load(std::memory_order_relaxed) > 0 || exit_;
+		});
+		idle_--;
+	}
+}
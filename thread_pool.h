@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * thread_pool.h - Work-stealing pool of worker threads
+ */
+#ifndef __SIMPLE_CAM_THREAD_POOL_H__
+#define __SIMPLE_CAM_THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+#include "callable.h"
+
+/*
+ * The ThreadPool runs tasks on a fixed set of worker threads. Each worker has
+ * its own bounded task queue, and tasks are distributed across the queues in
+ * a round-robin fashion. Workers that run out of tasks steal them from the
+ * queues of the other workers, so that a slow task only delays the tasks
+ * queued behind it until another worker becomes idle.
+ *
+ * Queues are preallocated, submitting a task never allocates memory. When all
+ * queues are full, the task is run synchronously by the caller.
+ *
+ * Workers can be spread over NUMA nodes, and bound to the CPUs of their node.
+ * Tasks submitted for a node are then queued to the workers of that node
+ * first, and idle workers steal from the queues of their own node before the
+ * queues of the other nodes.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int numThreads, size_t queueSize = 64,
+		   const std::vector<unsigned int> &nodes = {});
+	~ThreadPool();
+
+	unsigned int size() const { return workers_.size(); }
+
+	void submit(Callable &&task, int node = -1);
+
+private:
+	struct Worker {
+		Worker(size_t queueSize)
+			: tasks(queueSize), head(0), count(0), node(-1)
+		{
+		}
+
+		std::mutex lock;
+		std::vector<Callable> tasks;
+		size_t head;
+		size_t count;
+
+		/* NUMA node, CPUs, and queues to pop tasks from in order. */
+		int node;
+		std::vector<unsigned int> cpus;
+		std::vector<unsigned int> order;
+
+		std::thread thread;
+	};
+
+	bool push(Worker *worker, Callable &&task);
+	bool pop(Worker *worker, Callable *task);
+
+	void run(unsigned int index);
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::vector<std::vector<unsigned int>> nodeWorkers_;
+	std::atomic<unsigned int> next_;
+
+	/*
+	 * Number of tasks queued and not yet picked by a worker. It is only
+	 * incremented with the lock held, so that idle workers can't miss a
+	 * new task. It is incremented after the task is queued, and can thus
+	 * briefly be negative when a worker picks the task first.
+	 */
+	std::atomic<int> pending_;
+	unsigned int idle_;
+	bool exit_;
+	std::mutex lock_;
+	std::condition_variable cond_;
+};
+
+#endif /* __SIMPLE_CAM_THREAD_POOL_H__ */
@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * trace.cpp - Capture trace files, for replay without a camera
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace libcamera;
+using namespace trace;
+
+namespace {
+
+constexpr char kMagic[4] = { 'S', 'C', 'T', 'R' };
+constexpr uint32_t kVersion = 1;
+
+/* Frame headers are aligned to 64-bit. */
+constexpr size_t kAlignment = 8;
+
+size_t alignUp(size_t value)
+{
+	return (value + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+} /* namespace */
+
+/* -----------------------------------------------------------------------------
+ * TraceWriter
+ */
+
+/*
+ * The layout of the buffers is recorded from the first buffer of each stream,
+ * so that the replayed buffers can be laid out the same way.
+ */
+TraceWriter::TraceWriter(const std::string &filename,
+			 const CameraConfiguration &config,
+			 const FrameBufferAllocator &allocator, size_t queueSize)
+	: filename_(filename), header_{}, valid_(true), queue_(queueSize),
+	  pending_(0), running_(false), fd_(-1), frames_(0), bytes_(0),
+	  dropped_(0), failed_(false)
+{
+	memcpy(header_.magic, kMagic, sizeof(header_.magic));
+	header_.version = kVersion;
+	header_.recordSize = sizeof(FrameRecord);
+	header_.numStreams = std::min<size_t>(config.size(), kMaxStreams);
+
+	for (unsigned int i = 0; i < header_.numStreams; ++i) {
+		const StreamConfiguration &cfg = config.at(i);
+		StreamInfo &info = header_.streams[i];
+
+		info.modifier = cfg.pixelFormat.modifier();
+		info.fourcc = cfg.pixelFormat.fourcc();
+		info.width = cfg.size.width;
+		info.height = cfg.size.height;
+		info.stride = cfg.stride;
+		info.frameSize = cfg.frameSize;
+
+		const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+			allocator.buffers(cfg.stream());
+		if (buffers.empty()) {
+			valid_ = false;
+			continue;
+		}
+
+		const std::vector<FrameBuffer::Plane> &planes = buffers[0]->planes();
+		int fd = planes[0].fd.get();
+
+		for (const FrameBuffer::Plane &plane : planes) {
+			if (info.numPlanes == FrameRecord::kMaxPlanes ||
+			    plane.fd.get() != fd) {
+				valid_ = false;
+				break;
+			}
+
+			info.planeOffset[info.numPlanes] = plane.offset;
+			info.planeLength[info.numPlanes] = plane.length;
+			info.numPlanes++;
+		}
+	}
+}
+
+TraceWriter::~TraceWriter()
+{
+	stop();
+}
+
+int TraceWriter::start()
+{
+	/* Replay requires all the planes of a buffer to share a dmabuf. */
+	if (!valid_) {
+		std::cerr << filename_ << ": can't trace buffers with planes in "
+			  << "separate dmabufs" << std::endl;
+		return -ENOTSUP;
+	}
+
+	fd_ = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd_ < 0) {
+		int ret = -errno;
+		std::cerr << "Failed to open " << filename_ << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	if (::write(fd_, &header_, sizeof(header_)) != sizeof(header_)) {
+		int ret = -errno;
+		std::cerr << filename_ << ": write failed: " << strerror(-ret)
+			  << std::endl;
+		close(fd_);
+		fd_ = -1;
+		return ret;
+	}
+
+	frames_ = 0;
+	bytes_ = sizeof(header_);
+	dropped_ = 0;
+	failed_ = false;
+
+	running_ = true;
+	thread_ = std::thread(&TraceWriter::run, this);
+
+	return 0;
+}
+
+/* All the frames queued so far are written before stopping. */
+void TraceWriter::stop()
+{
+	if (!thread_.joinable())
+		return;
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		running_ = false;
+	}
+
+	cond_.notify_one();
+	thread_.join();
+
+	std::cout << filename_ << ": traced " << frames_ << " frames, "
+		  << bytes_ / 1000000 << " MB";
+	if (dropped_)
+		std::cout << ", dropped " << dropped_ << " frames";
+	std::cout << std::endl;
+
+	close(fd_);
+	fd_ = -1;
+}
+
+/*
+ * Failed frames are traced too, without data, for the consumers to see the
+ * same sequence of frames when replayed.
+ */
+void TraceWriter::processFrame(Frame *frame)
+{
+	if (frame->streamIndex() >= header_.numStreams)
+		return;
+
+	frame->acquire();
+	if (!queue_.push(std::move(frame))) {
+		dropped_++;
+		frame->release();
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> locker(lock_);
+		pending_++;
+	}
+
+	cond_.notify_one();
+}
+
+void TraceWriter::run()
+{
+	for (;;) {
+		unsigned int count;
+
+		{
+			std::unique_lock<std::mutex> locker(lock_);
+			cond_.wait(locker, [&]() { return pending_ || !running_; });
+
+			count = pending_;
+			pending_ = 0;
+
+			if (!count && !running_)
+				break;
+		}
+
+		while (count--) {
+			Frame *frame;
+			if (!queue_.pop(&frame))
+				break;
+
+			write(frame);
+
+			/* The buffer can now be reused by the camera. */
+			frame->release();
+		}
+	}
+}
+
+/*
+ * The plane data is written straight from the buffer mappings, along with the
+ * header, with a single system call.
+ */
+void TraceWriter::write(Frame *frame)
+{
+	static const uint8_t padding[kAlignment] = {};
+
+	if (failed_)
+		return;
+
+	const FrameMetadata &metadata = frame->metadata();
+	const Image &image = frame->image();
+
+	FrameHeader header = {};
+	header.completed = frame->completed();
+	header.status = metadata.status;
+	header.record = frame->record();
+	header.record.numPlanes = 0;
+
+	struct iovec iov[FrameRecord::kMaxPlanes + 2];
+	unsigned int count = 0;
+	size_t size = 0;
+
+	iov[count++] = { &header, sizeof(header) };
+
+	if (metadata.status == FrameMetadata::FrameSuccess) {
+		for (unsigned int i = 0; i < image.numPlanes(); ++i) {
+			if (i == FrameRecord::kMaxPlanes)
+				break;
+
+			Span<const uint8_t> data = image.data(i);
+			size_t length = std::min<size_t>(metadata.planes()[i].bytesused,
+							 data.size());
+
+			iov[count++] = { const_cast<uint8_t *>(data.data()), length };
+			header.record.bytesused[header.record.numPlanes++] = length;
+			size += length;
+		}
+	}
+
+	header.size = alignUp(size);
+	if (header.size > size)
+		iov[count++] = { const_cast<uint8_t *>(padding), header.size - size };
+
+	size_t total = sizeof(header) + header.size;
+	size_t written = 0;
+
+	while (written < total) {
+		ssize_t ret = writev(fd_, iov, count);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			std::cerr << filename_ << ": write failed: "
+				  << strerror(errno) << std::endl;
+			failed_ = true;
+			return;
+		}
+
+		written += ret;
+
+		/* Skip the vectors written completely after a short write. */
+		size_t done = ret;
+		unsigned int i = 0;
+		while (i < count && done >= iov[i].iov_len)
+			done -= iov[i++].iov_len;
+
+		if (i < count) {
+			iov[i].iov_base = static_cast<uint8_t *>(iov[i].iov_base) + done;
+			iov[i].iov_len -= done;
+		}
+
+		memmove(iov, iov + i, (count - i) * sizeof(*iov));
+		count -= i;
+	}
+
+	frames_++;
+	bytes_ += total;
+}
+
+/* -----------------------------------------------------------------------------
+ * TraceReader
+ */
+
+/*
+ * The whole trace is mapped, and indexed by walking the frame headers. Traces
+ * cut short by an interrupted capture are read up to the last complete frame.
+ */
+std::unique_ptr<TraceReader> TraceReader::open(const std::string &filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		std::cerr << "Failed to open " << filename << ": "
+			  << strerror(errno) << std::endl;
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+		std::cerr << "Invalid trace " << filename << std::endl;
+		close(fd);
+		return nullptr;
+	}
+
+	void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		std::cerr << "Failed to map " << filename << ": "
+			  << strerror(errno) << std::endl;
+		return nullptr;
+	}
+
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	std::unique_ptr<TraceReader> reader{ new TraceReader() };
+	reader->map_ = static_cast<const uint8_t *>(map);
+	reader->mapSize_ = st.st_size;
+
+	const Header *header = reinterpret_cast<const Header *>(reader->map_);
+	if (memcmp(header->magic, kMagic, sizeof(kMagic)) ||
+	    header->version != kVersion ||
+	    header->recordSize != sizeof(FrameRecord) ||
+	    !header->numStreams || header->numStreams > kMaxStreams) {
+		std::cerr << "Invalid trace " << filename << std::endl;
+		return nullptr;
+	}
+
+	reader->header_ = header;
+
+	size_t offset = sizeof(Header);
+	while (offset + sizeof(FrameHeader) <= reader->mapSize_) {
+		const FrameHeader *frame =
+			reinterpret_cast<const FrameHeader *>(reader->map_ + offset);
+		size_t size = sizeof(FrameHeader) + frame->size;
+
+		if (size > reader->mapSize_ - offset ||
+		    frame->record.stream >= header->numStreams ||
+		    frame->record.numPlanes > FrameRecord::kMaxPlanes)
+			break;
+
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < frame->record.numPlanes; ++i)
+			bytes += frame->record.bytesused[i];
+
+		if (bytes > frame->size)
+			break;
+
+		reader->frames_.push_back(offset);
+		offset += size;
+	}
+
+	if (offset != reader->mapSize_) {
+		std::cerr << filename << ": trace truncated after "
+			  << reader->frames_.size() << " frames" << std::endl;
+		reader->truncated_ = true;
+	}
+
+	return reader;
+}
+
+TraceReader::~TraceReader()
+{
+	if (map_)
+		munmap(const_cast<uint8_t *>(map_), mapSize_);
+}
+
+const FrameHeader &TraceReader::frame(size_t index) const
+{
+	return *reinterpret_cast<const FrameHeader *>(map_ + frames_[index]);
+}
+
+Span<const uint8_t> TraceReader::data(size_t index, unsigned int plane) const
+{
+	const FrameRecord &record = frame(index).record;
+	if (plane >= record.numPlanes)
+		return {};
+
+	size_t offset = frames_[index] + sizeof(FrameHeader);
+	for (unsigned int i = 0; i < plane; ++i)
+		offset += record.bytesused[i];
+
+	return { map_ + offset, record.bytesused[plane] };
+}
@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * trace.h - Capture trace files, for replay without a camera
+ */
+#ifndef __SIMPLE_CAM_TRACE_H__
+#define __SIMPLE_CAM_TRACE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libcamera/base/span.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/framebuffer_allocator.h>
+
+#include "frame_logger.h"
+#include "frame_sink.h"
+#include "mpsc_queue.h"
+
+/*
+ * A trace holds all the frames captured by a camera, with everything needed
+ * to feed them again to the consumers: the configuration and buffer layout of
+ * the streams, and for each frame its metadata, the time the request
+ * completed at, and the data of its planes.
+ *
+ *   +--------+---------------+------+---------------+------+-----+
+ *   | Header | FrameHeader 0 | Data | FrameHeader 1 | Data | ... |
+ *   +--------+---------------+------+---------------+------+-----+
+ *
+ * Frames are stored in completion order. The data of a frame is padded to
+ * keep the frame headers aligned.
+ */
+namespace trace {
+
+constexpr unsigned int kMaxStreams = 4;
+
+struct StreamInfo {
+	uint64_t modifier;
+	uint32_t fourcc;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint32_t frameSize;
+	uint32_t numPlanes;
+	/* Layout of the planes in the buffers, all stored in a single dmabuf. */
+	uint32_t planeOffset[FrameRecord::kMaxPlanes];
+	uint32_t planeLength[FrameRecord::kMaxPlanes];
+};
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t numStreams;
+	StreamInfo streams[kMaxStreams];
+};
+
+struct FrameHeader {
+	/* Time the request completed at, in nanoseconds (CLOCK_MONOTONIC). */
+	uint64_t completed;
+	/* The libcamera::FrameMetadata::Status of the frame. */
+	uint32_t status;
+	/* Size of the data and padding following the header. */
+	uint32_t size;
+	FrameRecord record;
+};
+
+} /* namespace trace */
+
+/*
+ * The TraceWriter appends the frames of all the streams of a camera to a
+ * trace file, from a background thread. Frames are held until they have been
+ * written, and only then released.
+ */
+class TraceWriter : public FrameSink
+{
+public:
+	TraceWriter(const std::string &filename,
+		    const libcamera::CameraConfiguration &config,
+		    const libcamera::FrameBufferAllocator &allocator,
+		    size_t queueSize);
+	~TraceWriter();
+
+	int start() override;
+	void stop() override;
+
+	void processFrame(Frame *frame) override;
+	bool failed() const override { return failed_; }
+
+private:
+	void run();
+	void write(Frame *frame);
+
+	std::string filename_;
+	trace::Header header_;
+	bool valid_;
+
+	MpscQueue<Frame *> queue_;
+	std::mutex lock_;
+	std::condition_variable cond_;
+	unsigned int pending_;
+	bool running_;
+	std::thread thread_;
+
+	int fd_;
+	uint64_t frames_;
+	uint64_t bytes_;
+	std::atomic<uint64_t> dropped_;
+	bool failed_;
+};
+
+class TraceReader
+{
+public:
+	static std::unique_ptr<TraceReader> open(const std::string &filename);
+	~TraceReader();
+
+	const trace::Header &header() const { return *header_; }
+
+	/* Number of frames in the trace, in completion order. */
+	size_t size() const { return frames_.size(); }
+
+	/* True if the trace ends with an incomplete or invalid frame. */
+	bool truncated() const { return truncated_; }
+
+	const trace::FrameHeader &frame(size_t index) const;
+	libcamera::Span<const uint8_t> data(size_t index, unsigned int plane) const;
+
+private:
+	TraceReader() = default;
+
+	const uint8_t *map_ = nullptr;
+	size_t mapSize_ = 0;
+
+	const trace::Header *header_;
+	/* Offset of the header of each frame in the file. */
+	std::vector<size_t> frames_;
+	bool truncated_ = false;
+};
+
+#endif /* __SIMPLE_CAM_TRACE_H__ */
@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * watchdog.cpp - Frame stall detection and recovery
+ */
+
+#include "watchdog.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "clock.h"
+
+namespace {
+
+/*
+ * Time allowed for the first frame after the camera is started, which
+ * includes filling the pipeline.
+ */
+constexpr uint64_t kStartTimeout = 1000000000ULL;
+
+/* Smallest stall timeout, to tolerate the scheduling jitter. */
+constexpr uint64_t kMinTimeout = 5000000ULL;
+
+} /* namespace */
+
+Watchdog::Watchdog(EventLoop *loop, const std::string &name,
+		   unsigned int frames, Callable &&recover)
+	: loop_(loop), name_(name), frames_(frames), recover_(std::move(recover)),
+	  stopped_(true), timer_(0),
+	  deadline_(0), lastCompletion_(0), lastSequence_(0), interval_(0),
+	  started_(false), stallStart_(0), stalls_(0), downtime_(0), maxDowntime_(0)
+{
+}
+
+Watchdog::~Watchdog()
+{
+	stop();
+}
+
+/*
+ * Start watching the camera, once it has been started. The first frame is
+ * given more time to complete.
+ */
+void Watchdog::start()
+{
+	stopped_.store(false, std::memory_order_relaxed);
+	started_ = false;
+	lastCompletion_ = monotonicNs();
+	arm(lastCompletion_);
+}
+
+/*
+ * Stop watching the camera. When called from another thread while the check
+ * runs, the timer it may arm is ignored when it fires.
+ */
+void Watchdog::stop()
+{
+	stopped_.store(true, std::memory_order_relaxed);
+
+	EventLoop::TimerId timer = timer_.exchange(0);
+	if (timer)
+		loop_->cancelTimer(timer);
+}
+
+/*
+ * Record the completion of a frame, with its completion time, its sequence
+ * number, and its duration from the metadata, or zero if unknown.
+ */
+void Watchdog::frameCompleted(uint64_t completed, unsigned int sequence,
+			      uint64_t frameDuration)
+{
+	if (frameDuration) {
+		interval_ = frameDuration;
+	} else if (started_ && sequence != lastSequence_ && !stallStart_) {
+		/* Average the measured intervals over a few frames. */
+		uint64_t interval = completed - lastCompletion_;
+		interval_ = interval_ ? (interval_ * 7 + interval) / 8 : interval;
+	}
+
+	if (stallStart_) {
+		uint64_t downtime = completed - stallStart_;
+
+		downtime_ += downtime;
+		maxDowntime_ = std::max(maxDowntime_, downtime);
+		stallStart_ = 0;
+	}
+
+	started_ = true;
+	lastCompletion_ = completed;
+	lastSequence_ = sequence;
+
+	/*
+	 * Frames normally push the deadline further, which the check accounts
+	 * for when the timer fires. Rearm the timer only when the deadline
+	 * moves earlier, when switching from the start timeout to the stall
+	 * timeout, or when the frame interval decreases.
+	 */
+	if (completed + stallTimeout() < deadline_) {
+		EventLoop::TimerId timer = timer_.exchange(0);
+		if (timer) {
+			loop_->cancelTimer(timer);
+			arm(completed);
+		}
+	}
+}
+
+uint64_t Watchdog::stallTimeout() const
+{
+	if (!started_ || !interval_)
+		return kStartTimeout;
+
+	return std::max(interval_ * frames_, kMinTimeout);
+}
+
+void Watchdog::arm(uint64_t now)
+{
+	deadline_ = lastCompletion_ + stallTimeout();
+	uint64_t delay = deadline_ > now ? deadline_ - now : 0;
+
+	timer_ = loop_->addTimer(std::chrono::microseconds(delay / 1000 + 1),
+				 [this]() { check(); });
+}
+
+void Watchdog::check()
+{
+	uint64_t now = monotonicNs();
+
+	timer_ = 0;
+
+	if (stopped_.load(std::memory_order_relaxed))
+		return;
+
+	if (now - lastCompletion_ < stallTimeout()) {
+		arm(now);
+		return;
+	}
+
+	/*
+	 * A stall lasts until a frame completes, across failed recovery
+	 * attempts.
+	 */
+	if (!stallStart_) {
+		stallStart_ = lastCompletion_;
+		stalls_++;
+	}
+
+	std::cerr << name_ << ": No frame completed for "
+		  << (now - lastCompletion_) / 1000000 << " ms after sequence "
+		  << lastSequence_ << ", restarting" << std::endl;
+
+	recover_();
+
+	/*
+	 * The recovery handler restarts the watchdog, also when the restart
+	 * failed, for the next timeout to retry. Keep checking otherwise.
+	 */
+	if (!timer_) {
+		lastCompletion_ = now;
+		started_ = false;
+		arm(now);
+	}
+}
+
+void Watchdog::report(std::ostream &out, const std::string &prefix) const
+{
+	out << prefix << stalls_ << " stalls";
+
+	if (stalls_)
+		out << ", downtime " << std::fixed << std::setprecision(1)
+		    << downtime_ / 1000000.0 << " ms (max "
+		    << maxDowntime_ / 1000000.0 << " ms)" << std::defaultfloat;
+
+	out << std::endl;
+}
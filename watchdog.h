@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy.
+ *
+ * watchdog.h - Frame stall detection and recovery
+ */
+#ifndef __SIMPLE_CAM_WATCHDOG_H__
+#define __SIMPLE_CAM_WATCHDOG_H__
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+
+#include "callable.h"
+#include "event_loop.h"
+
+/*
+ * The Watchdog detects when a camera stops delivering frames, and calls a
+ * recovery handler to restart it.
+ *
+ * The camera is considered stalled when no frame has completed for a number
+ * of frame intervals. The interval is the frame duration reported in the
+ * metadata, or otherwise measured from the completions. The check runs from
+ * a one-shot timer, armed for the time at which the next frame becomes
+ * overdue, so there is no periodic polling.
+ *
+ * The downtime of every stall is measured from the last frame completed
+ * before the stall to the first frame completed after the recovery.
+ *
+ * All functions must be called from the thread of the event loop, except
+ * stop() which can be called from any thread.
+ */
+class Watchdog
+{
+public:
+	Watchdog(EventLoop *loop, const std::string &name, unsigned int frames,
+		 Callable &&recover);
+	~Watchdog();
+
+	void start();
+	void stop();
+
+	void frameCompleted(uint64_t completed, unsigned int sequence,
+			    uint64_t frameDuration);
+
+	uint64_t stalls() const { return stalls_; }
+	void report(std::ostream &out, const std::string &prefix) const;
+
+private:
+	uint64_t stallTimeout() const;
+	void arm(uint64_t now);
+	void check();
+
+	EventLoop *loop_;
+	std::string name_;
+	unsigned int frames_;
+	Callable recover_;
+	std::atomic<bool> stopped_;
+	std::atomic<EventLoop::TimerId> timer_;
+	uint64_t deadline_;
+
+	uint64_t lastCompletion_;
+	unsigned int lastSequence_;
+	uint64_t interval_;
+	bool started_;
+
+	/* Start of the current stall, or zero when not recovering. */
+	uint64_t stallStart_;
+	uint64_t stalls_;
+	uint64_t downtime_;
+	uint64_t maxDowntime_;
+};
+
+#endif /* __SIMPLE_CAM_WATCHDOG_H__ */